@@ -0,0 +1,356 @@
+#ifndef _libconfig_alias_included_
+#define _libconfig_alias_included_
+
+#include "Statistics.h"
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <boost/format.hpp>
+#include <boost/foreach.hpp>
+#include <boost/function.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+
+namespace libconfig {
+
+  // ==========================================================================
+  // The '#include_section "address" as "alias"' declarations of a
+  // configuration, each resolved to the item it refers to when the index is
+  // built.  Following an alias in a lookup is then a single hash lookup, no
+  // matter how many aliases it takes to reach the item.
+  //
+  // The address of an alias is looked up from the top of the configuration,
+  // unless its first key is another alias declared in the same section, in
+  // which case it is looked up from that alias' item.  This is what allows
+  // chains such as:
+  //
+  //   #include_section "Section1.Section2" as "second"
+  //   #include_section "second" as "third"
+  //
+  // An alias whose address starts with its own name, such as "logging.server"
+  // as "logging", is looked up from the top.  Aliases that refer to each
+  // other in a cycle are an error.  Any other alias that can not be
+  // resolved, because its address goes through a value that is not a
+  // section or has a reference that can not be resolved, is only an error
+  // when a lookup follows it.
+  //
+  // Every alias is resolved by the constructor, after which the index is
+  // only read and can be shared by any number of threads.  The '${address}'
+  // references in the addresses of aliases are resolved by the resolver
+  // given to the constructor, if any.
+  //
+  // Tree is the read access to the configuration, TreeAccess or CompactTree.
+  template<typename Tree>
+  class AliasIndex
+  {
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Types
+
+      typedef typename Tree::section_type section_type;
+      typedef typename Tree::item_type item_type;
+
+      // Resolves the references in the address of an alias, given the index
+      // being built to look them up in.
+      typedef boost::function<std::string (const AliasIndex&,
+                                           const std::string&)> Resolver;
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Construction
+
+      explicit AliasIndex(const Tree& tree,
+                          Resolver const& resolver = Resolver())
+        : m_tree(tree)
+        LIBCONFIG_STATISTICS(, m_counter(NULL))
+      {
+        std::vector<section_type> sections;
+        m_tree.aliasSections(sections);
+        prv_build(sections, resolver);
+      }
+
+      // Index the aliases of the sections given, for a caller that already
+      // knows which sections declare aliases and so saves walking the tree.
+      AliasIndex(const Tree& tree, std::vector<section_type> const& sections,
+                 Resolver const& resolver = Resolver())
+        : m_tree(tree)
+        LIBCONFIG_STATISTICS(, m_counter(NULL))
+      {
+        prv_build(sections, resolver);
+      }
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Interface
+
+      const Tree& tree() const { return m_tree; }
+
+#ifdef LIBCONFIG_ENABLE_STATISTICS
+      // Count the aliases lookups follow.
+      void countAliases(boost::atomic<unsigned long>* counter)
+      {
+        m_counter = counter;
+      }
+#endif
+
+      // The item an alias declared in the section refers to, or an empty
+      // item if there is no such alias or it does not refer to anything.
+      item_type alias(section_type section, const std::string& key) const
+      {
+        const Alias* alias = prv_alias(section, key);
+        return alias != NULL ? alias->target : item_type();
+      }
+
+      // The same, except that an alias whose address goes through a value
+      // sets the status to LookupNotSection, and one with a reference that
+      // can not be resolved throws.
+      item_type alias(section_type section, const std::string& key,
+                      LookupStatus& status) const
+      {
+        status = LookupFound;
+        return prv_follow(section, key, &status);
+      }
+
+      // Find the item specified by the keys in the range [key, last),
+      // starting in the section and following aliases where a key is not
+      // found.  Returns an empty item if it is not found.
+      template<typename KeyIterator>
+      item_type find(section_type section, KeyIterator key,
+                     KeyIterator last) const
+      {
+        return prv_find(section, key, last, false, NULL);
+      }
+
+      // The same, except that a key before the last that is not a section
+      // sets the status to LookupNotSection instead of throwing.  An item
+      // that is not found sets it to LookupNotFound.
+      template<typename KeyIterator>
+      item_type find(section_type section, KeyIterator key,
+                     KeyIterator last, LookupStatus& status) const
+      {
+        status = LookupFound;
+        item_type item = prv_find(section, key, last, false, &status);
+        if(not item and status == LookupFound)
+          status = LookupNotFound;
+        return item;
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Types
+
+      // An alias and the item it refers to, which is filled in while the
+      // index is built, or why it does not refer to anything.
+      struct Alias
+      {
+        enum State { Pending, Resolving, Resolved };
+
+        explicit Alias(const std::string& address)
+          : address(address)
+          , target()
+          , state(Pending)
+          , notSection(false)
+        {}
+
+        std::string address;
+        mutable item_type target;
+        mutable State state;
+        mutable bool notSection;
+        mutable std::string error;
+      };
+
+      // Thrown for a cycle of aliases, which unlike the other errors of an
+      // alias is not kept until the alias is followed.
+      struct CircularAlias : std::runtime_error
+      {
+        explicit CircularAlias(const std::string& message)
+          : std::runtime_error(message)
+        {}
+      };
+
+      typedef boost::unordered_map<std::string, Alias> Aliases;
+      typedef boost::unordered_map<section_type, Aliases> Sections;
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Member Functions
+
+      // The last key of an address is only looked up as an alias when
+      // resolving the address of another alias, a lookup of the alias
+      // itself does not find anything.  A key that is not a section throws
+      // unless there is a status to report it in.
+      template<typename KeyIterator>
+      item_type prv_find(section_type section, KeyIterator key,
+                         KeyIterator last, bool aliasLast,
+                         LookupStatus* status) const
+      {
+        item_type item = m_tree.find(section, *key);
+
+        // If the key is the last key in the configuration address, then this
+        // is the config item.
+        if(key + 1 == last)
+          return item or not aliasLast ?
+            item : prv_follow(section, *key, status);
+
+        // RECURSION: Lookup the key and attempt to access the next section.
+        if(item)
+        {
+          section_type next;
+          if(not m_tree.section(item, next))
+            return prv_notSection(status);
+          item_type found = prv_find(next, key + 1, last, aliasLast, status);
+          if(found or (status != NULL and *status != LookupFound))
+            return found;
+        }
+
+        // Check for the address in an #include_section.
+        item = prv_follow(section, *key, status);
+        if(item)
+        {
+          LIBCONFIG_STATISTICS(if(m_counter != NULL)
+                                 LookupCounters::count(*m_counter);)
+          section_type next;
+          if(not m_tree.section(item, next))
+            return prv_notSection(status);
+          return prv_find(next, key + 1, last, aliasLast, status);
+        }
+        return item_type();
+      }
+
+      static item_type prv_notSection(LookupStatus* status)
+      {
+        if(status == NULL)
+          throw std::runtime_error("The specified key is not a section");
+        *status = LookupNotSection;
+        return item_type();
+      }
+
+      // The resolver is only kept while the index is built.
+      void prv_build(std::vector<section_type> const& sections,
+                     Resolver const& resolver)
+      {
+        BOOST_FOREACH(section_type section, sections)
+          prv_collect(section);
+        m_resolver = resolver;
+        BOOST_FOREACH(typename Sections::value_type& section, m_sections) {
+          BOOST_FOREACH(typename Aliases::value_type& alias, section.second)
+            prv_resolve(section.first, alias.first, alias.second);
+        }
+        m_resolver.clear();
+      }
+
+      // Find the aliases declared in the section.
+      void prv_collect(section_type section)
+      {
+        section_type references;
+        item_type item = m_tree.find(section, "$references");
+        if(item and m_tree.section(item, references))
+        {
+          std::vector<std::pair<std::string, item_type> > items;
+          m_tree.items(references, items);
+          Aliases& aliases = m_sections[section];
+          std::string address;
+          for(std::size_t i = 0; i != items.size(); ++i) {
+            if(m_tree.get(items[i].second, address))
+              aliases.insert(std::make_pair(items[i].first, Alias(address)));
+          }
+        }
+      }
+
+      // The alias declared in the section, or NULL if there is none.
+      const Alias* prv_alias(section_type section,
+                             const std::string& key) const
+      {
+        typename Sections::const_iterator it = m_sections.find(section);
+        if(it == m_sections.end())
+          return NULL;
+        typename Aliases::const_iterator alias = it->second.find(key);
+        if(alias == it->second.end())
+          return NULL;
+        return &alias->second;
+      }
+
+      // The item an alias declared in the section refers to, reporting why
+      // it does not refer to anything as prv_find does.  The alias is
+      // resolved first if the index is still being built.
+      item_type prv_follow(section_type section, const std::string& key,
+                           LookupStatus* status) const
+      {
+        const Alias* alias = prv_alias(section, key);
+        if(alias == NULL)
+          return item_type();
+        prv_resolve(section, key, *alias);
+        if(not alias->error.empty())
+          throw std::runtime_error(alias->error);
+        if(alias->notSection)
+          return prv_notSection(status);
+        return alias->target;
+      }
+
+      // Resolve the item an alias refers to, once.  Only a cycle throws, any
+      // other error is kept with the alias for prv_follow to report.
+      void prv_resolve(section_type section, const std::string& key,
+                       const Alias& alias) const
+      {
+        if(alias.state == Alias::Resolved)
+          return;
+        if(alias.state == Alias::Resolving)
+          throw CircularAlias(boost::str(boost::format(
+                  "Circular #include_section \"%1%\" as \"%2%\".")
+                  % alias.address % key));
+        alias.state = Alias::Resolving;
+
+        try {
+          std::string address =
+            m_resolver ? m_resolver(*this, alias.address) : alias.address;
+          std::vector<std::string> keys;
+          boost::split(keys, address, boost::is_any_of("."));
+
+          LookupStatus status = LookupFound;
+          const Alias* first = prv_alias(section, keys.front());
+          if(first != NULL and first != &alias)
+          {
+            alias.target = prv_follow(section, keys.front(), &status);
+            section_type next;
+            if(keys.size() > 1 and alias.target) {
+              if(m_tree.section(alias.target, next))
+                alias.target = prv_find(next, keys.begin() + 1, keys.end(),
+                                        true, &status);
+              else
+                status = LookupNotSection;
+            }
+          }
+          else
+          {
+            alias.target = prv_find(m_tree.root(), keys.begin(), keys.end(),
+                                    true, &status);
+          }
+          alias.notSection = status == LookupNotSection;
+        }
+        catch(CircularAlias const&) {
+          throw;
+        }
+        catch(std::runtime_error const& e) {
+          alias.error = e.what();
+        }
+        if(alias.notSection or not alias.error.empty())
+          alias.target = item_type();
+        alias.state = Alias::Resolved;
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Members
+
+      Tree m_tree;
+      Sections m_sections;
+      Resolver m_resolver;
+      LIBCONFIG_STATISTICS(boost::atomic<unsigned long>* m_counter;)
+  };
+
+} // namespace libconfig
+
+#endif // _libconfig_alias_included_
@@ -0,0 +1,317 @@
+#ifndef _libconfig_batch_included_
+#define _libconfig_batch_included_
+
+#include "Types.h"
+#include "Path.h"
+#include "Alias.h"
+#include "Compact.h"
+#include "Lazy.h"
+#include "Configuration.h"
+#include "Statistics.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+namespace libconfig {
+
+  // ==========================================================================
+  // A set of addresses to look up in a configuration together, each with
+  // the variable its value is stored in, such as the settings a component
+  // reads when it starts.  The addresses are sorted so that those sharing
+  // a prefix are next to each other, and the sections of the prefix are
+  // found once for all of them rather than from the top of the
+  // configuration for each.  Addresses reached through '#include_section'
+  // aliases are found as lookupValue finds them.
+  //
+  // Nothing is thrown for an address that is missing, that goes through a
+  // value or whose value is of another type; each address has a status
+  // instead, as tryLookupValue returns.  Errors in the configuration itself
+  // are thrown as by lookupValue.
+  //
+  //   LookupBatch batch;
+  //   batch.add("server.port", port);
+  //   batch.add("server.host", host);
+  //   if(batch.lookup(configuration) != batch.size()) ...
+  //
+  // The variables must outlive the batch, which can be used to look up the
+  // same addresses again, in the same or another configuration.
+  class LookupBatch
+  {
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Interface
+
+      template<typename T>
+      void add(const std::string& address, T& value)
+      {
+        m_entries.push_back(Entry(address, &value));
+        prv_added<T>();
+      }
+
+      template<typename T>
+      void add(const ConfigPath& path, T& value)
+      {
+        m_entries.push_back(Entry(path, &value));
+        prv_added<T>();
+      }
+
+      void reserve(std::size_t size) { m_entries.reserve(size); }
+
+      // Look up every address, storing the values of those that are found.
+      // Returns the number found.
+      std::size_t lookup(const Configuration& configuration)
+      {
+        if(m_order.size() != m_entries.size())
+          prv_sort();
+        if(configuration.m_compactIndex)
+          return prv_lookup(configuration, *configuration.m_compactIndex);
+        if(configuration.m_lazyIndex)
+          return prv_lookup(configuration, *configuration.m_lazyIndex);
+        return prv_lookup(configuration, *configuration.m_treeIndex);
+      }
+
+      // The addresses in the order they were added, and the status of each
+      // from the last lookup.
+      std::size_t size() const { return m_entries.size(); }
+
+      const std::string& address(std::size_t i) const
+      {
+        return m_entries[i].path.address();
+      }
+
+      LookupStatus status(std::size_t i) const { return m_entries[i].status; }
+
+      // The indexes of the addresses that were not found or not read by the
+      // last lookup.
+      std::vector<std::size_t> failed() const
+      {
+        std::vector<std::size_t> failed;
+        for(std::size_t i = 0; i != m_entries.size(); ++i)
+          if(m_entries[i].status != LookupFound)
+            failed.push_back(i);
+        return failed;
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Types
+
+      // Reads an item in to the variable of an entry, which is only known
+      // to the function add instantiated for it.
+      template<typename Tree>
+      struct Reader
+      {
+        typedef LookupStatus (*type)(const Configuration&,
+                                     const AliasIndex<Tree>&,
+                                     typename Tree::item_type, void*);
+      };
+
+      struct Entry
+      {
+        template<typename Path>
+        Entry(const Path& path, void* value)
+          : path(path)
+          , value(value)
+          , status(LookupNotFound)
+          , readTree(NULL)
+          , readCompact(NULL)
+          , readLazy(NULL)
+        {}
+
+        ConfigPath path;
+        void* value;
+        LookupStatus status;
+        Reader<TreeAccess>::type readTree;
+        Reader<CompactTree>::type readCompact;
+        Reader<LazyTree>::type readLazy;
+      };
+
+      // Orders entries by their addresses.  The addresses that share a
+      // prefix of keys share the prefix of characters up to the dot after
+      // the last key, so they are next to each other.
+      struct AddressLess
+      {
+        explicit AddressLess(std::vector<Entry> const& entries)
+          : m_entries(entries)
+        {}
+
+        bool operator()(std::size_t a, std::size_t b) const
+        {
+          return m_entries[a].path.address() < m_entries[b].path.address();
+        }
+
+        std::vector<Entry> const& m_entries;
+      };
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Member Functions
+
+      template<typename T>
+      void prv_added()
+      {
+        Entry& entry = m_entries.back();
+        entry.readTree = &prv_read<TreeAccess, T>;
+        entry.readCompact = &prv_read<CompactTree, T>;
+        entry.readLazy = &prv_read<LazyTree, T>;
+        m_order.clear();
+      }
+
+      template<typename Tree, typename T>
+      static LookupStatus prv_read(const Configuration& configuration,
+                                   const AliasIndex<Tree>& index,
+                                   typename Tree::item_type item, void* value)
+      {
+        return configuration.prv_getValue(index, item,
+                                          *static_cast<T*>(value), false);
+      }
+
+      static Reader<TreeAccess>::type prv_reader(const Entry& entry,
+                                                 const TreeAccess&)
+      {
+        return entry.readTree;
+      }
+
+      static Reader<CompactTree>::type prv_reader(const Entry& entry,
+                                                  const CompactTree&)
+      {
+        return entry.readCompact;
+      }
+
+      static Reader<LazyTree>::type prv_reader(const Entry& entry,
+                                               const LazyTree&)
+      {
+        return entry.readLazy;
+      }
+
+      void prv_sort()
+      {
+        m_order.resize(m_entries.size());
+        for(std::size_t i = 0; i != m_order.size(); ++i)
+          m_order[i] = i;
+        std::sort(m_order.begin(), m_order.end(), AddressLess(m_entries));
+      }
+
+      // Look up the entries in address order.  The sections found for the keys
+      // of one address are kept, and the next address starts from the
+      // deepest of them it shares a prefix with.
+      template<typename Tree>
+      std::size_t prv_lookup(const Configuration& configuration,
+                             const AliasIndex<Tree>& index)
+      {
+        typedef typename Tree::section_type section_type;
+        typedef typename Tree::item_type item_type;
+        const Tree& tree = index.tree();
+
+        // sections[i] is the section named by the first i keys of the
+        // previous address.
+        std::vector<section_type> sections(1, tree.root());
+        const std::vector<std::string>* previous = NULL;
+        std::size_t found = 0;
+        BOOST_FOREACH(std::size_t i, m_order)
+        {
+          Entry& entry = m_entries[i];
+          const std::vector<std::string>& keys = entry.path.keys();
+
+          std::size_t shared = 0;
+          if(previous != NULL)
+            while(shared + 1 < sections.size() and
+                  shared + 1 < keys.size() and
+                  keys[shared] == (*previous)[shared])
+              ++shared;
+          sections.resize(shared + 1);
+          previous = &keys;
+
+          LookupStatus status = LookupNotFound;
+          item_type item = prv_find(configuration, index, keys, sections,
+                                    status);
+          if(item)
+            status = prv_reader(entry, tree)(configuration, index, item,
+                                             entry.value);
+          entry.status = status;
+          found += status == LookupFound;
+          LIBCONFIG_STATISTICS(
+            LookupCounters::count(configuration.m_counters.lookups);
+            LookupCounters::count(status == LookupFound ?
+                                  configuration.m_counters.hits :
+                                  configuration.m_counters.misses);)
+        }
+        return found;
+      }
+
+      // Find the item of the keys, extending the sections found so far as
+      // far as the keys name sections.  Where the item is not found below a
+      // key, the key is followed as an alias, from the last key before the
+      // item back to the first, as AliasIndex::find does.
+      template<typename Tree>
+      static typename Tree::item_type prv_find(
+          const Configuration& configuration,
+          const AliasIndex<Tree>& index,
+          const std::vector<std::string>& keys,
+          std::vector<typename Tree::section_type>& sections,
+          LookupStatus& status)
+      {
+        typedef typename Tree::section_type section_type;
+        typedef typename Tree::item_type item_type;
+        const Tree& tree = index.tree();
+
+        while(sections.size() < keys.size())
+        {
+          item_type item = tree.find(sections.back(),
+                                     keys[sections.size() - 1]);
+          section_type next;
+          if(not item)
+            break;
+          if(not tree.section(item, next)) {
+            status = LookupNotSection;
+            return item_type();
+          }
+          sections.push_back(next);
+        }
+        if(sections.size() == keys.size()) {
+          item_type item = tree.find(sections.back(), keys.back());
+          if(item) {
+            status = LookupFound;
+            return item;
+          }
+        }
+
+        for(std::size_t level = std::min(sections.size(), keys.size() - 1);
+            level-- > 0;)
+        {
+          item_type alias = index.alias(sections[level], keys[level],
+                                        status);
+          if(status == LookupNotSection)
+            return item_type();
+          if(not alias)
+            continue;
+          LIBCONFIG_STATISTICS(LookupCounters::count(
+              configuration.m_counters.aliasIndirections);)
+          section_type next;
+          if(not tree.section(alias, next)) {
+            status = LookupNotSection;
+            return item_type();
+          }
+          item_type item = index.find(next, keys.begin() + level + 1,
+                                      keys.end(), status);
+          if(item or status == LookupNotSection)
+            return item;
+        }
+        status = LookupNotFound;
+        return item_type();
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Members
+
+      std::vector<Entry> m_entries;
+      std::vector<std::size_t> m_order;
+  };
+
+} // namespace libconfig
+
+#endif // _libconfig_batch_included_
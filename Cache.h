@@ -0,0 +1,285 @@
+#ifndef _libconfig_cache_included_
+#define _libconfig_cache_included_
+
+#include "Types.h"
+#include "Include.h"
+
+#include <list>
+#include <sys/stat.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+namespace libconfig {
+  namespace parse {
+
+    // ========================================================================
+    // boost::variant visitor that estimates the number of bytes of memory
+    // used by a configuration tree.
+    struct FootprintVisitor : boost::static_visitor<std::size_t>
+    {
+      // The size of a std::map node holding a configuration item, the
+      // red-black tree node header is four words.
+      static std::size_t node()
+      {
+        return 4 * sizeof(void*) + sizeof(ConfigType::value_type);
+      }
+
+      static std::size_t string(std::string const& s)
+      {
+        return s.capacity() > 15 ? s.capacity() + 1 : 0;
+      }
+
+      template<typename T>
+      std::size_t operator()(T const&) const
+      {
+        return 0;
+      }
+
+      std::size_t operator()(std::string const& t) const
+      {
+        return string(t);
+      }
+
+      template<typename T>
+      std::size_t operator()(std::vector<T> const& t) const
+      {
+        return t.capacity() * sizeof(T);
+      }
+
+      std::size_t operator()(std::vector<std::string> const& t) const
+      {
+        std::size_t size = t.capacity() * sizeof(std::string);
+        BOOST_FOREACH(std::string const& s, t) {
+          size += string(s);
+        }
+        return size;
+      }
+
+      std::size_t operator()(ConfigType const& t) const
+      {
+        // The section itself is held by a boost::recursive_wrapper.
+        std::size_t size = sizeof(ConfigType);
+        BOOST_FOREACH(ConfigType::value_type const& value, t) {
+          size += node() + string(value.first)
+                + boost::apply_visitor(*this, value.second);
+        }
+        return size;
+      }
+    };
+
+    // Estimate the number of bytes of memory used by the configuration.
+    inline std::size_t footprint(ConfigType const& configuration)
+    {
+      return FootprintVisitor()(configuration);
+    }
+
+    // ========================================================================
+    // A parsed configuration file: the files it includes and the
+    // configuration items of the file itself.
+    struct Fragment
+    {
+      std::vector<IncludeDirective> includes;
+      ConfigType configuration;
+    };
+
+    // ========================================================================
+    // Identifies a version of a configuration file on disk.  Two keys are
+    // equal if they name the same file with the same size and modification
+    // time.
+    struct FragmentKey
+    {
+      FragmentKey()
+        : size(0)
+        , seconds(0)
+        , nanoseconds(0)
+      {}
+
+      // Make the key for the file, throws if the file does not exist.
+      explicit FragmentKey(boost::filesystem::path const& filename)
+        : path(boost::filesystem::canonical(filename).string())
+      {
+        struct stat status;
+        if(::stat(path.c_str(), &status) != 0)
+          throw std::runtime_error("Could not open input file: " + path);
+        size = status.st_size;
+        seconds = status.st_mtim.tv_sec;
+        nanoseconds = status.st_mtim.tv_nsec;
+      }
+
+      bool operator==(FragmentKey const& other) const
+      {
+        return size == other.size and seconds == other.seconds and
+               nanoseconds == other.nanoseconds and path == other.path;
+      }
+
+      std::string path;
+      long long size;
+      long long seconds;
+      long nanoseconds;
+    };
+
+    inline std::size_t hash_value(FragmentKey const& key)
+    {
+      std::size_t seed = boost::hash_value(key.path);
+      boost::hash_combine(seed, key.size);
+      boost::hash_combine(seed, key.seconds);
+      boost::hash_combine(seed, key.nanoseconds);
+      return seed;
+    }
+
+    // ========================================================================
+    // A process wide cache of parsed configuration files, shared by every
+    // call to parseConfigFile that enables it.  Fragments are evicted least
+    // recently used first once their estimated size exceeds the budget.
+    // The cache is safe to use from multiple threads.
+    class FragmentCache : boost::noncopyable
+    {
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Types
+
+        typedef boost::shared_ptr<const Fragment> pointer;
+
+        struct Statistics
+        {
+          Statistics()
+            : hits(0)
+            , misses(0)
+            , evictions(0)
+            , entries(0)
+            , bytes(0)
+          {}
+
+          std::size_t hits;
+          std::size_t misses;
+          std::size_t evictions;
+          std::size_t entries;
+          std::size_t bytes;
+        };
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Construction
+
+        explicit FragmentCache(std::size_t budget = 64 * 1024 * 1024)
+          : m_budget(budget)
+        {}
+
+        // The process wide cache.
+        static FragmentCache& instance()
+        {
+          static FragmentCache cache;
+          return cache;
+        }
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Interface
+
+        // Find the fragment for the key, returns an empty pointer and counts
+        // a miss if it is not cached.
+        pointer find(FragmentKey const& key)
+        {
+          boost::lock_guard<boost::mutex> lock(m_mutex);
+          Entries::iterator it = m_entries.find(key);
+          if(it == m_entries.end()) {
+            ++m_statistics.misses;
+            return pointer();
+          }
+          ++m_statistics.hits;
+          m_order.splice(m_order.begin(), m_order, it->second.position);
+          return it->second.fragment;
+        }
+
+        // Add the fragment to the cache, evicting the least recently used
+        // fragments if the cache is over its budget.
+        void insert(FragmentKey const& key, pointer const& fragment)
+        {
+          std::size_t bytes = footprint(fragment->configuration);
+          boost::lock_guard<boost::mutex> lock(m_mutex);
+          if(m_entries.find(key) != m_entries.end() or bytes > m_budget)
+            return;
+          m_order.push_front(key);
+          Entry& entry = m_entries[key];
+          entry.fragment = fragment;
+          entry.bytes = bytes;
+          entry.position = m_order.begin();
+          ++m_statistics.entries;
+          m_statistics.bytes += bytes;
+          prv_evict();
+        }
+
+        // Set the maximum estimated size of the cached fragments in bytes.
+        void budget(std::size_t budget)
+        {
+          boost::lock_guard<boost::mutex> lock(m_mutex);
+          m_budget = budget;
+          prv_evict();
+        }
+
+        // Drop every cached fragment, the counters are kept.
+        void clear()
+        {
+          boost::lock_guard<boost::mutex> lock(m_mutex);
+          m_entries.clear();
+          m_order.clear();
+          m_statistics.entries = 0;
+          m_statistics.bytes = 0;
+        }
+
+        Statistics statistics() const
+        {
+          boost::lock_guard<boost::mutex> lock(m_mutex);
+          return m_statistics;
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Private Types
+
+        struct Entry
+        {
+          pointer fragment;
+          std::size_t bytes;
+          std::list<FragmentKey>::iterator position;
+        };
+
+        typedef boost::unordered_map<FragmentKey, Entry> Entries;
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Private Member Functions
+
+        void prv_evict()
+        {
+          while(m_statistics.bytes > m_budget and not m_order.empty())
+          {
+            Entries::iterator it = m_entries.find(m_order.back());
+            m_statistics.bytes -= it->second.bytes;
+            --m_statistics.entries;
+            ++m_statistics.evictions;
+            m_entries.erase(it);
+            m_order.pop_back();
+          }
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Members
+
+        mutable boost::mutex m_mutex;
+        std::size_t m_budget;
+        Entries m_entries;
+        std::list<FragmentKey> m_order;
+        Statistics m_statistics;
+    };
+
+  } // namespace parse
+} // namespace libconfig
+
+#endif // _libconfig_cache_included_
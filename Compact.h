@@ -0,0 +1,891 @@
+#ifndef _libconfig_compact_included_
+#define _libconfig_compact_included_
+
+#include "Types.h"
+#include "View.h"
+
+#include <deque>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+namespace libconfig {
+
+  // ==========================================================================
+  // A read only configuration tree stored in a single contiguous arena
+  // instead of a tree of std::maps.  Every item is a fixed size node in one
+  // array, the items of a section are a contiguous range of that array sorted
+  // by key, each distinct key is stored once in a key table, and strings and
+  // lists are packed in to the same arena.  A lookup is a binary search of
+  // each section's range, which touches a few cache lines rather than a
+  // chain of heap allocated map nodes.
+  //
+  // Keys are interned: a key is found in a hash index of the key table once
+  // per lookup, after which the items of a section are compared by key id.
+  // Strings of up to eight characters are stored in the node itself, and
+  // longer strings are stored once no matter how many items share them.
+  //
+  // The arena is an image: every reference inside it is an offset from its
+  // start, so it does not depend on where it is in memory.  Copies of a
+  // CompactTree share the same arena.
+  class CompactTree
+  {
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Types
+
+      // A node in the tree.  The root section is node 0, which is never the
+      // item of a section, so 0 is also used for items that are not found.
+      typedef boost::uint32_t Index;
+      typedef Index section_type;
+      typedef Index item_type;
+
+      // The type of a node, in the same order as the types of a ConfigTree.
+      enum Type
+      {
+        String,
+        Double,
+        Int,
+        Int64,
+        Bool,
+        StringList,
+        DoubleList,
+        IntList,
+        Int64List,
+        EmptyList,
+        Section
+      };
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Construction
+
+      // Build the compact tree from a parsed configuration.
+      explicit CompactTree(const ConfigType& configuration)
+      {
+        Builder builder;
+        builder.build(configuration);
+        boost::shared_ptr<std::vector<boost::uint64_t> > arena(
+            new std::vector<boost::uint64_t>());
+        builder.image(*arena);
+        m_storage = arena;
+        prv_attach(reinterpret_cast<const char*>(&(*arena)[0]));
+      }
+
+      // Use an image made by another CompactTree, such as one mapped from a
+      // file.  The image must be aligned to 8 bytes and is kept alive by the
+      // storage.  Throws if the image is not a valid CompactTree image.
+      CompactTree(boost::shared_ptr<const void> const& storage,
+                  const char* image, std::size_t size)
+        : m_storage(storage)
+      {
+        if(not prv_valid(image, size))
+          throw std::runtime_error("Invalid compact configuration image.");
+        prv_attach(image);
+      }
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Interface
+
+      section_type root() const { return 0; }
+
+      // Find the item with the given key in a section, returns 0 if the
+      // section has no such key.
+      item_type find(section_type section, const std::string& key) const
+      {
+        const Node& node = m_nodes[section];
+        if(node.type != Section)
+          return 0;
+        boost::uint32_t id;
+        if(not prv_keyId(key, id))
+          return 0;
+        const Node* first = m_nodes + node.value;
+        const Node* last = first + node.count;
+        const Node* it = std::lower_bound(first, last, id, KeyLess());
+        if(it == last or it->key != id)
+          return 0;
+        return it - m_nodes;
+      }
+
+      // Returns true and sets the section if the item is a section.
+      bool section(item_type item, section_type& section) const
+      {
+        section = item;
+        return m_nodes[item].type == Section;
+      }
+
+      // Append the keys and items of a section.
+      void items(section_type section,
+                 std::vector<std::pair<std::string, item_type> >& items) const
+      {
+        const Node& node = m_nodes[section];
+        for(Index i = node.value; i != node.value + node.count; ++i)
+          items.push_back(std::make_pair(key(i), i));
+      }
+
+      // Append the sections that declare '#include_section' aliases, which
+      // are listed in the image.
+      void aliasSections(std::vector<section_type>& sections) const
+      {
+        sections.insert(sections.end(), m_aliases,
+                        m_aliases + m_header->aliasCount);
+      }
+
+      Type type(Index index) const
+      {
+        return static_cast<Type>(m_nodes[index].type);
+      }
+
+      // The key of a node, empty for the root.
+      std::string key(Index index) const
+      {
+        const Key& key = m_keys[m_nodes[index].key];
+        return std::string(prv_text(key.text, key.length), key.length);
+      }
+
+      // Retrieve the value of an item.  Each returns false, leaving the value
+      // untouched, if the item is not of the requested type.  Numbers are
+      // also read as a wider type, as readValue reads them.
+      bool get(item_type item, std::string& value) const
+      {
+        const Node& node = m_nodes[item];
+        if(node.type != String)
+          return false;
+        value.assign(prv_text(node.value, node.count), node.count);
+        return true;
+      }
+
+      bool get(item_type item, double& value) const
+      {
+        const Node& node = m_nodes[item];
+        if(node.type == Double)
+          std::memcpy(&value, &node.value, sizeof(value));
+        else if(node.type == Int or node.type == Int64)
+          value = static_cast<double>(static_cast<boost::int64_t>(node.value));
+        else
+          return false;
+        return true;
+      }
+
+      bool get(item_type item, int& value) const
+      {
+        const Node& node = m_nodes[item];
+        if(node.type != Int)
+          return false;
+        value = static_cast<int>(static_cast<boost::int64_t>(node.value));
+        return true;
+      }
+
+      bool get(item_type item, boost::int64_t& value) const
+      {
+        const Node& node = m_nodes[item];
+        if(node.type != Int64 and node.type != Int)
+          return false;
+        value = static_cast<boost::int64_t>(node.value);
+        return true;
+      }
+
+      bool get(item_type item, bool& value) const
+      {
+        const Node& node = m_nodes[item];
+        if(node.type != Bool)
+          return false;
+        value = node.value != 0;
+        return true;
+      }
+
+      // An empty list is an empty list of any type.
+      template<typename T>
+      bool get(item_type item, std::vector<T>& value) const
+      {
+        if(m_nodes[item].type == EmptyList) {
+          value.clear();
+          return true;
+        }
+        return prv_list(m_nodes[item], value);
+      }
+
+      // Views of the values in the arena.
+      bool get(item_type item, boost::string_ref& value) const
+      {
+        const Node& node = m_nodes[item];
+        if(node.type != String)
+          return false;
+        value = boost::string_ref(prv_text(node.value, node.count),
+                                  node.count);
+        return true;
+      }
+
+      template<typename T>
+      bool get(item_type item, ListView<T>& value) const
+      {
+        if(m_nodes[item].type == EmptyList) {
+          value = ListView<T>();
+          return true;
+        }
+        return prv_view(m_nodes[item], value);
+      }
+
+      // Copy a section out of the compact tree.
+      bool get(item_type item, ConfigType& value) const
+      {
+        const Node& node = m_nodes[item];
+        if(node.type != Section)
+          return false;
+        ConfigType section;
+        for(Index i = node.value; i != node.value + node.count; ++i)
+          prv_expand(i, section[key(i)]);
+        value.swap(section);
+        return true;
+      }
+
+      // The whole configuration as a ConfigType.
+      ConfigType expand() const
+      {
+        ConfigType configuration;
+        get(root(), configuration);
+        return configuration;
+      }
+
+      // The image and its size in bytes.
+      const char* data() const
+      { return reinterpret_cast<const char*>(m_header); }
+      std::size_t size() const { return m_header->size; }
+
+      std::size_t nodeCount() const { return m_header->nodeCount; }
+      std::size_t keyCount() const { return m_header->keyCount; }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Types
+
+      // The version of the image, changed with its layout and with the
+      // types of node.
+      enum { ImageVersion = 2 };
+
+      // The layout of the arena is the header followed by the nodes, the key
+      // table, the key index, the sections declaring aliases, the lists and
+      // finally the characters of the keys and strings.  Offsets in the
+      // header are from the start of the arena, offsets in nodes and keys
+      // are from the start of their pool.
+      struct Header
+      {
+        boost::uint32_t magic;
+        boost::uint32_t version;
+        boost::uint32_t nodeCount;
+        boost::uint32_t keyCount;
+        boost::uint32_t indexSize;
+        boost::uint32_t aliasCount;
+        boost::uint64_t nodes;
+        boost::uint64_t keys;
+        boost::uint64_t index;
+        boost::uint64_t aliases;
+        boost::uint64_t data;
+        boost::uint64_t chars;
+        boost::uint64_t size;
+      };
+
+      // For a section the value is the index of its first item and the count
+      // is the number of items.  For strings and lists the value is the
+      // offset of the characters or elements and the count is the length.
+      // Scalars are stored in the value, as are the characters of strings
+      // that fit in it.
+      struct Node
+      {
+        boost::uint32_t key;
+        boost::uint32_t type;
+        boost::uint64_t count;
+        boost::uint64_t value;
+      };
+
+      // An interned key.  The text is the offset of the characters, or the
+      // characters themselves if they fit, as for string nodes.
+      struct Key
+      {
+        boost::uint64_t text;
+        boost::uint32_t length;
+        boost::uint32_t hash;
+      };
+
+      // An element of a list of strings.
+      struct Text
+      {
+        boost::uint64_t length;
+        boost::uint64_t text;
+      };
+
+      // Orders the items of a section by key id.
+      struct KeyLess
+      {
+        bool operator()(Node const& node, boost::uint32_t id) const
+        {
+          return node.key < id;
+        }
+      };
+
+      // :: -------------------------------------------------------------------
+      // :: Builds the arena from a ConfigType, breadth first so that the
+      // :: items of each section are contiguous.
+      class Builder : public boost::static_visitor<>
+      {
+        public:
+          Builder()
+            : m_node(NULL)
+          {}
+
+          void build(const ConfigType& configuration)
+          {
+            typedef std::pair<boost::uint32_t, const ConfigType::value_type*>
+              Item;
+            std::deque<std::pair<Index, const ConfigType*> > sections;
+            std::vector<Item> items;
+            Node root = { prv_intern(""), Section, 0, 0 };
+            m_nodes.push_back(root);
+            sections.push_back(std::make_pair(0, &configuration));
+
+            while(not sections.empty())
+            {
+              Index index = sections.front().first;
+              const ConfigType& section = *sections.front().second;
+              sections.pop_front();
+
+              items.clear();
+              BOOST_FOREACH(ConfigType::value_type const& item, section)
+                items.push_back(Item(prv_intern(item.first), &item));
+              std::sort(items.begin(), items.end());
+
+              m_nodes[index].value = m_nodes.size();
+              m_nodes[index].count = section.size();
+              BOOST_FOREACH(Item const& item, items)
+              {
+                const ConfigTree& tree = item.second->second;
+                Node node = { item.first,
+                              static_cast<boost::uint32_t>(tree.which()),
+                              0, 0 };
+                m_node = &node;
+                boost::apply_visitor(*this, tree);
+                if(const ConfigType* child = boost::get<ConfigType>(&tree)) {
+                  sections.push_back(std::make_pair(m_nodes.size(), child));
+                  if(item.second->first == "$references")
+                    m_aliases.push_back(index);
+                }
+                m_nodes.push_back(node);
+              }
+            }
+            if(m_nodes.size() > Index(-1))
+              throw std::runtime_error("Configuration too large to compact.");
+          }
+
+          // Lay the pools out in one arena.
+          void image(std::vector<boost::uint64_t>& arena) const
+          {
+            // The key index is an open addressed hash table of key ids plus
+            // one, at most half full.
+            std::vector<boost::uint32_t> index(2);
+            while(index.size() < 2 * m_keys.size())
+              index.resize(index.size() * 2);
+            for(std::size_t id = 0; id != m_keys.size(); ++id) {
+              std::size_t slot = m_keys[id].hash & (index.size() - 1);
+              while(index[slot] != 0)
+                slot = (slot + 1) & (index.size() - 1);
+              index[slot] = id + 1;
+            }
+
+            Header header = { 0x4746434c, ImageVersion,
+                              static_cast<boost::uint32_t>(m_nodes.size()),
+                              static_cast<boost::uint32_t>(m_keys.size()),
+                              static_cast<boost::uint32_t>(index.size()),
+                              static_cast<boost::uint32_t>(m_aliases.size()),
+                              0, 0, 0, 0, 0, 0, 0 };
+            header.nodes = prv_align(sizeof(Header));
+            header.keys = header.nodes + m_nodes.size() * sizeof(Node);
+            header.index = header.keys + m_keys.size() * sizeof(Key);
+            header.aliases = header.index +
+                             prv_align(index.size() * sizeof(boost::uint32_t));
+            header.data = header.aliases +
+                          prv_align(m_aliases.size() * sizeof(Index));
+            header.chars = header.data + prv_align(m_data.size());
+            header.size = header.chars + m_chars.size();
+
+            arena.assign(prv_align(header.size) / 8, 0);
+            char* base = reinterpret_cast<char*>(&arena[0]);
+            std::memcpy(base, &header, sizeof(header));
+            std::memcpy(base + header.nodes, &m_nodes[0],
+                        m_nodes.size() * sizeof(Node));
+            std::memcpy(base + header.keys, &m_keys[0],
+                        m_keys.size() * sizeof(Key));
+            std::memcpy(base + header.index, &index[0],
+                        index.size() * sizeof(boost::uint32_t));
+            if(not m_aliases.empty())
+              std::memcpy(base + header.aliases, &m_aliases[0],
+                          m_aliases.size() * sizeof(Index));
+            std::memcpy(base + header.data, m_data.data(), m_data.size());
+            std::memcpy(base + header.chars, m_chars.data(), m_chars.size());
+          }
+
+          // :: Visitor filling in the value and count of m_node
+
+          void operator()(std::string const& t) const
+          {
+            m_node->count = t.size();
+            m_node->value = prv_text(t);
+          }
+
+          void operator()(double t) const
+          {
+            std::memcpy(&m_node->value, &t, sizeof(t));
+          }
+
+          void operator()(int t) const
+          {
+            m_node->value = static_cast<boost::uint64_t>(
+                                static_cast<boost::int64_t>(t));
+          }
+
+          void operator()(boost::int64_t t) const
+          {
+            m_node->value = static_cast<boost::uint64_t>(t);
+          }
+
+          void operator()(bool t) const
+          {
+            m_node->value = t;
+          }
+
+          void operator()(std::vector<std::string> const& t) const
+          {
+            std::vector<Text> texts;
+            BOOST_FOREACH(std::string const& s, t) {
+              Text text = { s.size(), prv_text(s) };
+              texts.push_back(text);
+            }
+            prv_list(texts);
+          }
+
+          template<typename T>
+          void operator()(std::vector<T> const& t) const
+          {
+            prv_list(t);
+          }
+
+          void operator()(std::vector<boost::none_t> const&) const
+          {}
+
+          void operator()(ConfigType const&) const
+          {}
+
+        private:
+          static std::size_t prv_align(std::size_t size)
+          {
+            return (size + 7) & ~std::size_t(7);
+          }
+
+          boost::uint32_t prv_intern(std::string const& key)
+          {
+            boost::unordered_map<std::string, boost::uint32_t>::iterator it =
+              m_keyIds.find(key);
+            if(it != m_keyIds.end())
+              return it->second;
+            Key entry = { prv_text(key),
+                          static_cast<boost::uint32_t>(key.size()),
+                          prv_hash(key.data(), key.size()) };
+            m_keys.push_back(entry);
+            m_keyIds.insert(std::make_pair(key, m_keys.size() - 1));
+            return m_keys.size() - 1;
+          }
+
+          // Store the characters of a string, in place if they fit otherwise
+          // in the character pool, once for each distinct string.
+          boost::uint64_t prv_text(std::string const& s) const
+          {
+            boost::uint64_t text = 0;
+            if(s.size() <= sizeof(text)) {
+              std::memcpy(&text, s.data(), s.size());
+              return text;
+            }
+            boost::unordered_map<std::string, boost::uint64_t>::iterator it =
+              m_texts.find(s);
+            if(it != m_texts.end())
+              return it->second;
+            text = m_chars.size();
+            m_chars.append(s);
+            m_texts.insert(std::make_pair(s, text));
+            return text;
+          }
+
+          template<typename T>
+          void prv_list(std::vector<T> const& t) const
+          {
+            m_node->count = t.size();
+            m_node->value = m_data.size();
+            if(not t.empty())
+              m_data.append(reinterpret_cast<const char*>(&t[0]),
+                            t.size() * sizeof(T));
+            m_data.resize(prv_align(m_data.size()));
+          }
+
+        private:
+          Node* m_node;
+          std::vector<Node> m_nodes;
+          std::vector<Key> m_keys;
+          std::vector<Index> m_aliases;
+          boost::unordered_map<std::string, boost::uint32_t> m_keyIds;
+          mutable boost::unordered_map<std::string, boost::uint64_t> m_texts;
+          mutable std::string m_data;
+          mutable std::string m_chars;
+      };
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Member Functions
+
+      // The hash of a key, FNV-1a so that it is the same in every process.
+      static boost::uint32_t prv_hash(const char* key, std::size_t length)
+      {
+        boost::uint32_t hash = 2166136261u;
+        for(std::size_t i = 0; i != length; ++i) {
+          hash ^= static_cast<unsigned char>(key[i]);
+          hash *= 16777619u;
+        }
+        return hash;
+      }
+
+      // Check that the header of an image describes pools that lie within
+      // it, in order, and that everything in the pools refers only to what
+      // lies within them, see prv_validPools.
+      static bool prv_valid(const char* image, std::size_t size)
+      {
+        if(reinterpret_cast<std::size_t>(image) % 8 != 0 or
+           size < sizeof(Header))
+          return false;
+        Header header;
+        std::memcpy(&header, image, sizeof(header));
+        if(not (header.magic == 0x4746434c and
+                header.version == ImageVersion and
+                header.size == size and header.nodeCount > 0 and
+                header.indexSize > 0 and
+                (header.indexSize & (header.indexSize - 1)) == 0 and
+                header.nodes % 8 == 0 and header.keys % 8 == 0 and
+                header.index % 4 == 0 and header.aliases % 4 == 0 and
+                header.data % 8 == 0 and
+                header.nodes >= sizeof(Header) and
+                header.keys >= header.nodes + sizeof(Node) *
+                                 boost::uint64_t(header.nodeCount) and
+                header.index >= header.keys + sizeof(Key) *
+                                  boost::uint64_t(header.keyCount) and
+                header.aliases >= header.index +
+                                  boost::uint64_t(header.indexSize) * 4 and
+                header.data >= header.aliases +
+                               boost::uint64_t(header.aliasCount) * 4 and
+                header.chars >= header.data and header.size >= header.chars))
+          return false;
+        return prv_validPools(image, header);
+      }
+
+      // Check every node, key, index slot and alias in one pass, so that a
+      // damaged image is refused rather than read out of bounds: keys and
+      // types must be known, the items of a section must be nodes after it,
+      // which also keeps sections from containing themselves, and strings
+      // and lists must lie within their pools.  The key index must have an
+      // empty slot for lookups of missing keys to stop at.
+      static bool prv_validPools(const char* image, const Header& header)
+      {
+        const Node* nodes = reinterpret_cast<const Node*>(image + header.nodes);
+        const Key* keys = reinterpret_cast<const Key*>(image + header.keys);
+        const boost::uint32_t* index =
+          reinterpret_cast<const boost::uint32_t*>(image + header.index);
+        const Index* aliases =
+          reinterpret_cast<const Index*>(image + header.aliases);
+        const char* data = image + header.data;
+        boost::uint64_t dataSize = header.chars - header.data;
+        boost::uint64_t charsSize = header.size - header.chars;
+
+        if(nodes[0].type != Section)
+          return false;
+        for(Index i = 0; i != header.nodeCount; ++i)
+        {
+          const Node& node = nodes[i];
+          if(node.key >= header.keyCount)
+            return false;
+          switch(node.type)
+          {
+            case String:
+              if(not prv_validText(node.value, node.count, charsSize))
+                return false;
+              break;
+            case Double:
+            case Int:
+            case Int64:
+            case Bool:
+            case EmptyList:
+              break;
+            case StringList:
+            {
+              if(not prv_validList(node, sizeof(Text), dataSize))
+                return false;
+              const Text* texts =
+                reinterpret_cast<const Text*>(data + node.value);
+              for(boost::uint64_t j = 0; j != node.count; ++j)
+                if(not prv_validText(texts[j].text, texts[j].length,
+                                     charsSize))
+                  return false;
+              break;
+            }
+            case DoubleList:
+              if(not prv_validList(node, sizeof(double), dataSize))
+                return false;
+              break;
+            case IntList:
+              if(not prv_validList(node, sizeof(int), dataSize))
+                return false;
+              break;
+            case Int64List:
+              if(not prv_validList(node, sizeof(boost::int64_t), dataSize))
+                return false;
+              break;
+            case Section:
+              if(not (node.value > i and node.value <= header.nodeCount and
+                      node.count <= header.nodeCount - node.value))
+                return false;
+              break;
+            default:
+              return false;
+          }
+        }
+
+        for(Index i = 0; i != header.keyCount; ++i)
+          if(not prv_validText(keys[i].text, keys[i].length, charsSize))
+            return false;
+
+        bool empty = false;
+        for(Index i = 0; i != header.indexSize; ++i) {
+          if(index[i] > header.keyCount)
+            return false;
+          empty = empty or index[i] == 0;
+        }
+        if(not empty)
+          return false;
+
+        for(Index i = 0; i != header.aliasCount; ++i)
+          if(aliases[i] >= header.nodeCount or
+             nodes[aliases[i]].type != Section)
+            return false;
+        return true;
+      }
+
+      // Whether the characters of a string or key lie within the character
+      // pool, or are stored in place.
+      static bool prv_validText(boost::uint64_t text, boost::uint64_t length,
+                                boost::uint64_t charsSize)
+      {
+        return length <= sizeof(text) or
+               (length <= charsSize and text <= charsSize - length);
+      }
+
+      // Whether the elements of a list lie within the list pool, aligned.
+      static bool prv_validList(const Node& node, std::size_t elementSize,
+                                boost::uint64_t dataSize)
+      {
+        return node.value % 8 == 0 and node.count <= dataSize / elementSize and
+               node.value <= dataSize - node.count * elementSize;
+      }
+
+      void prv_attach(const char* image)
+      {
+        m_header = reinterpret_cast<const Header*>(image);
+        m_nodes = reinterpret_cast<const Node*>(image + m_header->nodes);
+        m_keys = reinterpret_cast<const Key*>(image + m_header->keys);
+        m_index = reinterpret_cast<const boost::uint32_t*>(
+                      image + m_header->index);
+        m_aliases = reinterpret_cast<const Index*>(image + m_header->aliases);
+        m_data = image + m_header->data;
+        m_chars = image + m_header->chars;
+      }
+
+      // The characters of a string or key stored by the Builder.  The text
+      // must be the one in the arena, not a copy of it.
+      const char* prv_text(const boost::uint64_t& text,
+                           boost::uint64_t length) const
+      {
+        if(length <= sizeof(text))
+          return reinterpret_cast<const char*>(&text);
+        return m_chars + text;
+      }
+
+      // Find the id of an interned key, returns false if no item in the
+      // configuration has the key.
+      bool prv_keyId(const std::string& key, boost::uint32_t& id) const
+      {
+        boost::uint32_t h = prv_hash(key.data(), key.size());
+        boost::uint32_t mask = m_header->indexSize - 1;
+        for(boost::uint32_t slot = h & mask; m_index[slot] != 0;
+            slot = (slot + 1) & mask)
+        {
+          const Key& entry = m_keys[m_index[slot] - 1];
+          if(entry.hash == h and entry.length == key.size() and
+             std::memcmp(prv_text(entry.text, entry.length), key.data(),
+                         key.size()) == 0)
+          {
+            id = m_index[slot] - 1;
+            return true;
+          }
+        }
+        return false;
+      }
+
+      template<typename T>
+      const T* prv_elements(const Node& node) const
+      {
+        return reinterpret_cast<const T*>(m_data + node.value);
+      }
+
+      bool prv_list(const Node& node, std::vector<std::string>& value) const
+      {
+        if(node.type != StringList)
+          return false;
+        const Text* texts = prv_elements<Text>(node);
+        value.resize(node.count);
+        for(std::size_t i = 0; i != node.count; ++i)
+          value[i].assign(prv_text(texts[i].text, texts[i].length),
+                          texts[i].length);
+        return true;
+      }
+
+      bool prv_list(const Node& node, std::vector<double>& value) const
+      {
+        return prv_list<double>(node, DoubleList, value) or
+               prv_list<int>(node, IntList, value) or
+               prv_list<boost::int64_t>(node, Int64List, value);
+      }
+
+      bool prv_list(const Node& node, std::vector<int>& value) const
+      {
+        return prv_list<int>(node, IntList, value);
+      }
+
+      bool prv_list(const Node& node,
+                    std::vector<boost::int64_t>& value) const
+      {
+        return prv_list<boost::int64_t>(node, Int64List, value) or
+               prv_list<int>(node, IntList, value);
+      }
+
+      // Copy the elements of a list of the given type, stored as 'From'.
+      template<typename From, typename To>
+      bool prv_list(const Node& node, Type type, std::vector<To>& value) const
+      {
+        if(node.type != type)
+          return false;
+        const From* elements = prv_elements<From>(node);
+        value.assign(elements, elements + node.count);
+        return true;
+      }
+
+      template<typename T>
+      bool prv_list(const Node&, std::vector<T>&) const
+      {
+        return false;
+      }
+
+      bool prv_view(const Node& node, ListView<std::string>& value) const
+      {
+        if(node.type != StringList)
+          return false;
+        value = ListView<std::string>(prv_elements<Text>(node), m_chars,
+                                      &CompactTree::prv_readText, node.count);
+        return true;
+      }
+
+      bool prv_view(const Node& node, ListView<double>& value) const
+      {
+        if(node.type != DoubleList)
+          return false;
+        value = ListView<double>(prv_elements<double>(node), node.count);
+        return true;
+      }
+
+      bool prv_view(const Node& node, ListView<int>& value) const
+      {
+        if(node.type != IntList)
+          return false;
+        value = ListView<int>(prv_elements<int>(node), node.count);
+        return true;
+      }
+
+      bool prv_view(const Node& node, ListView<boost::int64_t>& value) const
+      {
+        if(node.type != Int64List)
+          return false;
+        value = ListView<boost::int64_t>(prv_elements<boost::int64_t>(node),
+                                         node.count);
+        return true;
+      }
+
+      template<typename T>
+      bool prv_view(const Node&, ListView<T>&) const
+      {
+        return false;
+      }
+
+      // Read an element of a list of strings for a ListView.
+      static boost::string_ref prv_readText(const void* elements,
+                                            const char* chars, std::size_t i)
+      {
+        const Text& text = static_cast<const Text*>(elements)[i];
+        if(text.length <= sizeof(text.text))
+          return boost::string_ref(
+                     reinterpret_cast<const char*>(&text.text), text.length);
+        return boost::string_ref(chars + text.text, text.length);
+      }
+
+      // Copy a node out as a ConfigTree.
+      void prv_expand(Index index, ConfigTree& tree) const
+      {
+        switch(type(index))
+        {
+          case String:     prv_expand<std::string>(index, tree); break;
+          case Double:     prv_expand<double>(index, tree); break;
+          case Int:        prv_expand<int>(index, tree); break;
+          case Int64:      prv_expand<boost::int64_t>(index, tree); break;
+          case Bool:       prv_expand<bool>(index, tree); break;
+          case StringList: prv_expand<std::vector<std::string> >(index, tree);
+                           break;
+          case DoubleList: prv_expand<std::vector<double> >(index, tree); break;
+          case IntList:    prv_expand<std::vector<int> >(index, tree); break;
+          case Int64List:  prv_expand<std::vector<boost::int64_t> >(index, tree);
+                           break;
+          case EmptyList:  tree = std::vector<boost::none_t>(); break;
+          case Section:    prv_expand<ConfigType>(index, tree); break;
+        }
+      }
+
+      template<typename T>
+      void prv_expand(Index index, ConfigTree& tree) const
+      {
+        T value;
+        get(index, value);
+        tree = value;
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Members
+
+      boost::shared_ptr<const void> m_storage;
+      const Header* m_header;
+      const Node* m_nodes;
+      const Key* m_keys;
+      const boost::uint32_t* m_index;
+      const Index* m_aliases;
+      const char* m_data;
+      const char* m_chars;
+  };
+
+} // namespace libconfig
+
+#endif // _libconfig_compact_included_
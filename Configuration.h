@@ -4,18 +4,153 @@
 #include "Types.h"
 #include "Parse.h"
 #include "Printing.h"
+#include "Output.h"
+#include "Path.h"
+#include "Compact.h"
+#include "Lazy.h"
+#include "Alias.h"
+#include "Snapshot.h"
+#include "Statistics.h"
+#include "View.h"
+#include "Query.h"
 
 #include <boost/algorithm/string/join.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
-#include <boost/regex.hpp>
+#include <boost/bind/bind.hpp>
 #include <boost/format.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
 
 namespace libconfig {
 
+  // ==========================================================================
+  // Read access to a ConfigType, the same interface as CompactTree provides so
+  // that the lookups can be written once for both.  Items that are not found
+  // are NULL.
+  class TreeAccess
+  {
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Types
+
+      typedef const ConfigType* section_type;
+      typedef const ConfigTree* item_type;
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Construction
+
+      explicit TreeAccess(const ConfigType& configuration)
+        : m_root(&configuration)
+      {}
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Interface
+
+      section_type root() const { return m_root; }
+
+      item_type find(section_type section, const std::string& key) const
+      {
+        ConfigType::const_iterator it = section->find(key);
+        return it == section->end() ? NULL : &it->second;
+      }
+
+      bool section(item_type item, section_type& section) const
+      {
+        section = boost::get<ConfigType>(item);
+        return section != NULL;
+      }
+
+      // Append the keys and items of a section.
+      void items(section_type section,
+                 std::vector<std::pair<std::string, item_type> >& items) const
+      {
+        BOOST_FOREACH(ConfigType::value_type const& item, *section)
+          items.push_back(std::make_pair(item.first, &item.second));
+      }
+
+      // Append the sections that declare '#include_section' aliases.
+      void aliasSections(std::vector<section_type>& sections) const
+      {
+        prv_aliasSections(m_root, sections);
+      }
+
+      // Numbers are also read as a wider type and an empty list as a list
+      // of any type, see readValue.
+      template<typename T>
+      bool get(item_type item, T& value) const
+      {
+        return readValue(*item, value);
+      }
+
+      // Views of the values stored in the tree.
+      bool get(item_type item, boost::string_ref& value) const
+      {
+        const std::string* t = boost::get<std::string>(item);
+        if(t == NULL)
+          return false;
+        value = *t;
+        return true;
+      }
+
+      template<typename T>
+      bool get(item_type item, ListView<T>& value) const
+      {
+        if(boost::get<std::vector<boost::none_t> >(item) != NULL) {
+          value = ListView<T>();
+          return true;
+        }
+        const std::vector<T>* t = boost::get<std::vector<T> >(item);
+        if(t == NULL)
+          return false;
+        value = ListView<T>(*t);
+        return true;
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Member Functions
+
+      static void prv_aliasSections(section_type section,
+                                    std::vector<section_type>& sections)
+      {
+        BOOST_FOREACH(ConfigType::value_type const& item, *section) {
+          if(const ConfigType* child = boost::get<ConfigType>(&item.second)) {
+            if(item.first == "$references")
+              sections.push_back(section);
+            prv_aliasSections(child, sections);
+          }
+        }
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Members
+
+      const ConfigType* m_root;
+  };
+
   // ==========================================================================
   // Configuraiton class is the main interface to loading and parsing libconfig
   // files.
+  //
+  // Lookups are const and never modify the configuration, so any number of
+  // threads can look up values in one Configuration at the same time.  A
+  // lazy configuration parses sections as they are first looked up in, each
+  // under its own lock.  Loading, compacting or resolving the references of
+  // a configuration do modify it, and must not run while it is being read;
+  // use a ReloadableConfiguration to replace a configuration that is in use.
+  // References to environment variables are read with getenv, which is only
+  // safe while no thread changes the environment.
   class Configuration
   {
     private:
@@ -60,13 +195,53 @@ namespace libconfig {
       // :: -------------------------------------------------------------------
       // :: Construction
 
+      // An empty configuration, to load or loadSnapshot in to.
+      Configuration()
+        : m_resolved(false)
+      {
+        prv_buildIndex();
+      }
+
       Configuration(const ConfigType& configurationMap)
         : m_configurationMap(configurationMap)
-      {}
+        , m_resolved(false)
+      {
+        prv_buildIndex();
+      }
 
-      Configuration(const std::string& configFilename)
-        : m_configurationMap(parse::parseConfigFile(configFilename))
-      {}
+      Configuration(const std::string& configFilename,
+                    parse::ParseOptions const& options = parse::ParseOptions())
+        : m_resolved(false)
+      {
+        load(configFilename, options);
+      }
+
+      // The alias index refers to the configuration it was built for, so it
+      // is rebuilt for a copy.
+      Configuration(const Configuration& other)
+        : m_configurationMap(other.m_configurationMap)
+        , m_compact(other.m_compact)
+        , m_lazy(other.m_lazy)
+        , m_resolved(other.m_resolved)
+        , m_environment(other.m_environment)
+      {
+        LIBCONFIG_STATISTICS(m_statistics = other.m_statistics;)
+        prv_buildIndex();
+      }
+
+      Configuration& operator=(const Configuration& other)
+      {
+        if(this != &other) {
+          m_configurationMap = other.m_configurationMap;
+          m_compact = other.m_compact;
+          m_lazy = other.m_lazy;
+          m_resolved = other.m_resolved;
+          m_environment = other.m_environment;
+          LIBCONFIG_STATISTICS(m_statistics = other.m_statistics;)
+          prv_buildIndex();
+        }
+        return *this;
+      }
 
     public:
       // :: -------------------------------------------------------------------
@@ -75,216 +250,710 @@ namespace libconfig {
       // Lookup a configuration item given the address and the value where the
       // item will be stored.  Returns 'true' or 'false' depending on if the 
       // item is found in the configuration.
+      //
+      // Numbers are stored as an int, a boost::int64_t or a double as they
+      // are written, see parse::Number, and can also be looked up as a wider
+      // type: an int as a boost::int64_t, and either as a double.  Lists of
+      // numbers are lists of doubles, so they can be viewed as a
+      // ListView<double>, unless they hold 64 bit integers and no doubles,
+      // when they are lists of boost::int64_t and are viewed as those; a
+      // list of boost::int64_t can still be copied in to a list of doubles.
+      //
+      // Strings and lists can also be looked up as a boost::string_ref or a
+      // ListView, which refer to the value stored in the configuration
+      // rather than copying it.  A view is valid until the configuration is
+      // loaded, compacted, has its references resolved, is assigned to or
+      // merged in to by a ConfigurationWatcher, or is destroyed.  A string
+      // can only be viewed once its references have been resolved, as the
+      // string stored is not the string that would be looked up.
       template<typename T>
-      bool lookupValue(const std::string& address, T& value)
+      bool lookupValue(const std::string& address, T& value) const
       {
-        std::vector<std::string> keys;
-        boost::split(keys, address, boost::is_any_of("."));
-        return prv_lookupValue(m_configurationMap, value, keys);
+        return lookupValue(ConfigPath(address), value);
       }
 
-      void load(std::string configFilename)
+      // Lookup a configuration item given an address compiled in to a
+      // ConfigPath.  Use this for addresses that are looked up repeatedly,
+      // looking up scalar values this way does not allocate.
+      template<typename T>
+      bool lookupValue(const ConfigPath& path, T& value) const
       {
-        m_configurationMap = parse::parseConfigFile(configFilename);
+        LIBCONFIG_STATISTICS(LookupCounters::count(m_counters.lookups);)
+        bool found = prv_lookupValue(value, path.begin(), path.end());
+        LIBCONFIG_STATISTICS(LookupCounters::count(
+                               found ? m_counters.hits : m_counters.misses);)
+        return found;
       }
 
-      // Print the configuration to std::cout
-      void print()
+      // Lookup a configuration item without throwing when it is missing, a
+      // key on the way to it is not a section or it is of another type,
+      // for settings that are optional or may be of several types.  The
+      // value is only set if the status is LookupFound.  Errors in the
+      // configuration itself, such as a reference that can not be resolved
+      // or a lazily parsed section that does not parse, are still thrown.
+      template<typename T>
+      LookupStatus tryLookupValue(const std::string& address, T& value) const
       {
-        printing::ConfigPrinter()(m_configurationMap);
+        return tryLookupValue(ConfigPath(address), value);
       }
 
-    private:
-      // :: ------------------------------------------------------------------
-      // :: Private Member Functions
-
-      // Retrieve a value from a map, this is used for the last key in the
-      // configuration address.
       template<typename T>
-      bool prv_getValue(const ConfigType& subConfig,
-                        const std::string& key, T& value)
+      LookupStatus tryLookupValue(const ConfigPath& path, T& value) const
       {
-        if(subConfig.find(key) == subConfig.end())
-          return false;
-        try {
-          value = boost::get<T>(subConfig.find(key)->second);
+        LIBCONFIG_STATISTICS(LookupCounters::count(m_counters.lookups);)
+        LookupStatus status = LookupNotFound;
+        if(m_compactIndex)
+          status = prv_tryLookupValue(*m_compactIndex, value,
+                                      path.begin(), path.end());
+        else if(m_lazyIndex)
+          status = prv_tryLookupValue(*m_lazyIndex, value,
+                                      path.begin(), path.end());
+        else
+          status = prv_tryLookupValue(*m_treeIndex, value,
+                                      path.begin(), path.end());
+        LIBCONFIG_STATISTICS(LookupCounters::count(
+            status == LookupFound ? m_counters.hits : m_counters.misses);)
+        return status;
+      }
+
+      // Append the addresses of every section and value in a section and
+      // the sections in it, in order; all of them for an empty address.
+      // The addresses are taken from an index of the whole configuration,
+      // built the first time it is enumerated or queried, which parses all
+      // of a lazy configuration.
+      void enumerate(const std::string& address,
+                     std::vector<std::string>& addresses) const
+      {
+        prv_paths()->enumerate(address, addresses);
+      }
+
+      // Append the addresses that match a glob pattern, in order.  A '*'
+      // matches any characters including dots, so "Section.*" is everything
+      // in Section and "*.timeout" every timeout, and a '?' matches any one
+      // character.  See PathIndex.
+      void query(const std::string& pattern,
+                 std::vector<std::string>& addresses) const
+      {
+        prv_paths()->query(pattern, addresses);
+      }
+
+      // Load the configuration file, or only scan it if the options are
+      // lazy.
+      void load(std::string configFilename,
+                parse::ParseOptions const& options = parse::ParseOptions())
+      {
+        Statistics* statistics = NULL;
+        LIBCONFIG_STATISTICS(Stopwatch stopwatch;
+                             Statistics loaded;
+                             statistics = &loaded;)
+        if(options.lazy) {
+          m_lazy = LazyTree(configFilename);
+          ConfigType().swap(m_configurationMap);
         }
-        catch(boost::bad_get e) {
-          throw std::runtime_error("Type requested does not match"
-                                   "the configuration item's type.");
+        else {
+          parse::parseConfigFile(configFilename, options, statistics)
+            .swap(m_configurationMap);
+          m_lazy = boost::none;
         }
-        return true;
+        m_compact = boost::none;
+        m_resolved = false;
+        m_environment.clear();
+        LIBCONFIG_STATISTICS(double parsed = stopwatch.lap();)
+        prv_buildIndex();
+        LIBCONFIG_STATISTICS(loaded.indexSeconds = stopwatch.lap();
+                             loaded.loadSeconds = parsed + loaded.indexSeconds;
+                             m_statistics = loaded;)
       }
-      
-      // Specialization for lookupValue when the value type is a list, this is
-      // to handle empty lists.
-      template<typename T>
-      bool prv_getValue(const ConfigType& subConfig,
-                        const std::string& key, std::vector<T>& value)
+
+      // Load the configuration from a snapshot written by compileSnapshot,
+      // or parse the configuration file if the snapshot is missing, damaged,
+      // older than the files it was compiled from or was resolved with
+      // environment variables that have changed since.  Returns true if the
+      // snapshot was used.  See readSnapshot for verify.
+      bool loadSnapshot(const std::string& snapshotFilename,
+                        const std::string& configFilename,
+                        parse::ParseOptions const& options = 
+                          parse::ParseOptions(),
+                        bool verify = false)
       {
-        if(subConfig.find(key) == subConfig.end())
+        LIBCONFIG_STATISTICS(Stopwatch stopwatch;)
+        SnapshotEnvironment environment;
+        boost::optional<CompactTree> snapshot = 
+          readSnapshot(snapshotFilename, configFilename, verify, &environment);
+        if(not snapshot) {
+          load(configFilename, options);
           return false;
-        try {
-          value = boost::get<std::vector<T> >(
-                          subConfig.find(key)->second);
-        }
-        catch(boost::bad_get) {
-          try {
-            boost::get<std::vector<boost::none_t> >(
-                    subConfig.find(key)->second);
-            value = std::vector<T>();
-          }
-          catch(boost::bad_get) {
-            throw std::runtime_error("Type requested does not match"
-                                     "the configuration item's type.");
-          }
         }
+        ConfigType().swap(m_configurationMap);
+        m_compact = snapshot;
+        m_lazy = boost::none;
+        m_resolved = true;
+        m_environment.swap(environment);
+        LIBCONFIG_STATISTICS(double read = stopwatch.lap();)
+        prv_buildIndex();
+        LIBCONFIG_STATISTICS(m_statistics = Statistics();
+                             m_statistics.indexSeconds = stopwatch.lap();
+                             m_statistics.loadSeconds =
+                               read + m_statistics.indexSeconds;)
         return true;
       }
 
-      // Specialization for std::string values, this will look up any references
-      // in the string values.
-      bool prv_getValue(const ConfigType& subConfig,
-                        const std::string& key, std::string& value)
+      // Resolve the references of the configuration, compact it and write it
+      // to a snapshot file.  The snapshot is stale once any of the sources
+      // changes, or any of the environment variables the references were
+      // resolved with.
+      void saveSnapshot(const std::string& snapshotFilename,
+                        const SnapshotSources& sources)
       {
-        if(subConfig.find(key) == subConfig.end())
-          return false;
-        try {
-          value = prv_resolveReferences(
-                          boost::get<std::string>(subConfig.find(key)->second));
+        resolveReferences();
+        compact();
+        writeSnapshot(snapshotFilename, *m_compact, sources, m_environment);
+      }
+
+      // Resolve the '${address}' references in every string value once, so
+      // that looking up a string is a plain read.  Each string is resolved
+      // after the strings it refers to, and a reference that can not be
+      // resolved or a cycle of references is an error.  The environment
+      // variables used are kept for saveSnapshot.
+      void resolveReferences()
+      {
+        if(m_resolved)
+          return;
+        LIBCONFIG_STATISTICS(Stopwatch stopwatch;)
+        prv_expandLazy();
+        ConfigType expanded;
+        if(m_compact)
+          expanded = m_compact->expand();
+        ConfigType& configuration = m_compact ? expanded : m_configurationMap;
+
+        References references;
+        SnapshotEnvironment environment;
+        prv_collectReferences(configuration, "", references);
+        AliasIndex<TreeAccess> index(TreeAccess(configuration),
+                                     prv_resolver<TreeAccess>());
+        BOOST_FOREACH(References::value_type& reference, references)
+          prv_resolveReference(index, references, reference.second,
+                               environment);
+        BOOST_FOREACH(References::value_type& reference, references)
+          reference.second.value->swap(reference.second.resolved);
+
+        if(m_compact)
+          m_compact = CompactTree(expanded);
+        m_resolved = true;
+        m_environment.swap(environment);
+        prv_buildIndex();
+        LIBCONFIG_STATISTICS(m_statistics.resolveSeconds = stopwatch.lap();)
+      }
+
+      // Returns true if the references have been resolved.
+      bool isResolved() const { return m_resolved; }
+
+      // Move the configuration in to a CompactTree and free the map.  The
+      // configuration can not be changed afterwards but uses far less memory
+      // and is faster to look up in, which suits large configurations.
+      void compact()
+      {
+        if(m_compact)
+          return;
+        prv_expandLazy();
+        m_compact = CompactTree(m_configurationMap);
+        ConfigType().swap(m_configurationMap);
+        prv_buildIndex();
+      }
+
+      // Returns true if the configuration is held in a CompactTree.
+      bool isCompact() const { return bool(m_compact); }
+
+      // Returns true if the configuration is parsed as it is looked up in.
+      bool isLazy() const { return bool(m_lazy); }
+
+      // Print the configuration to std::cout
+      void print() const
+      {
+        if(m_compact)
+          printing::ConfigPrinter()(m_compact->expand());
+        else if(m_lazy)
+          printing::ConfigPrinter()(m_lazy->expand());
+        else
+          printing::ConfigPrinter()(m_configurationMap);
+      }
+
+      // What loading the configuration cost, what it holds and the lookups
+      // made in it so far.  Only collected when the library is compiled
+      // with LIBCONFIG_ENABLE_STATISTICS, see Statistics.  The contents are
+      // counted on each call, so this walks the whole configuration.
+      Statistics statistics() const
+      {
+        Statistics statistics;
+#ifdef LIBCONFIG_ENABLE_STATISTICS
+        statistics = m_statistics;
+        statistics.enabled = true;
+        boost::unordered_set<std::string> keys;
+        if(m_compact) {
+          countTree(*m_compact, m_compact->root(), statistics, keys);
+          statistics.memoryBytes = m_compact->size();
         }
-        catch(boost::bad_get e) {
-          throw std::runtime_error("Type requested does not match"
-                                   "the configuration item's type.");
+        else if(not m_lazy) {
+          TreeAccess tree(m_configurationMap);
+          countTree(tree, tree.root(), statistics, keys);
+          statistics.memoryBytes = parse::footprint(m_configurationMap);
         }
-        return true;
+        statistics.keys = keys.size();
+        m_counters.read(statistics);
+#endif
+        return statistics;
       }
 
-      bool prv_getValueAsString(const ConfigType& subConfig,
-                                const std::string& key, std::string& value)
+      // Write the configuration to the output in the configuration file
+      // syntax.  Parsing the output gives back the same configuration.
+      void write(printing::OutputBuffer& output) const
       {
-        if(subConfig.find(key) == subConfig.end()) 
-          return false;
-        value = boost::apply_visitor(FormatValue(), subConfig.find(key)->second);
-        return true;
+        if(m_compact)
+          printing::writeConfig(m_compact->expand(), output);
+        else if(m_lazy)
+          printing::writeConfig(m_lazy->expand(), output);
+        else
+          printing::writeConfig(m_configurationMap, output);
       }
 
-      // Recursive lookupValue function to traverse the configuration tree
-      // searching for the configuration item specified in the address.
-      template<typename T>
-      bool prv_lookupValue(const ConfigType& subConfig,
-                           T& value, const std::vector<std::string>& keys, 
-                           size_t keysIdx = 0, bool convertToString = false)
-      {
-        // If the index is the last key in the configuration address, then get
-        // the value of the config item.
-        if(keys.size() == keysIdx + 1)
-          return convertToString 
-            ? prv_getValueAsString(subConfig, keys[keysIdx], value)
-            : prv_getValue(subConfig, keys[keysIdx], value);
-        
-        // RECURSION: Lookup the key and attempt to access the next section.
-        if(subConfig.find(keys[keysIdx]) != subConfig.end()) 
-        {
-          try {
-            if(prv_lookupValue(
-                 boost::get<ConfigType>(subConfig.find(keys[keysIdx])->second),
-                 value, keys, keysIdx + 1)) 
-            {
-              return true;
-            }
-          }
-          catch(boost::bad_get e) {
-            throw std::runtime_error("The specified key is not a section");
-          }
+    private:
+      // :: ------------------------------------------------------------------
+      // :: Private Types
+
+      // A string value containing references, while they are resolved.  The
+      // values are only replaced once every one has been resolved, so that
+      // an error leaves the configuration as it was.
+      struct Reference
+      {
+        enum State { Pending, Resolving, Resolved };
+
+        Reference(std::string* value, const std::string& address)
+          : value(value)
+          , address(address)
+          , state(Pending)
+        {}
+
+        std::string* value;
+        std::string address;
+        std::string resolved;
+        State state;
+      };
+
+      typedef boost::unordered_map<const ConfigTree*, Reference> References;
+
+    private:
+      // :: ------------------------------------------------------------------
+      // :: Private Member Functions
+
+      // Build the alias index of the compact tree if the configuration has
+      // been compacted, of the lazy tree if it is lazy, otherwise of the
+      // configuration map.
+      void prv_buildIndex()
+      {
+        m_paths.reset();
+        m_treeIndex = boost::none;
+        m_compactIndex = boost::none;
+        m_lazyIndex = boost::none;
+        if(m_compact)
+          m_compactIndex.emplace(*m_compact, prv_resolver<CompactTree>());
+        else if(m_lazy)
+          m_lazyIndex.emplace(*m_lazy, prv_resolver<LazyTree>());
+        else
+          m_treeIndex.emplace(TreeAccess(m_configurationMap),
+                              prv_resolver<TreeAccess>());
+        LIBCONFIG_STATISTICS(prv_countAliases();)
+      }
+
+      // Resolves the references in the addresses of aliases as they are
+      // indexed, unless the references have all been resolved already.
+      template<typename Tree>
+      typename AliasIndex<Tree>::Resolver prv_resolver() const
+      {
+        if(m_resolved)
+          return typename AliasIndex<Tree>::Resolver();
+        return boost::bind(&Configuration::prv_resolveReferences<Tree>, this,
+                           boost::placeholders::_1, boost::placeholders::_2);
+      }
+
+      // Parse the rest of a lazy configuration in to the configuration map.
+      void prv_expandLazy()
+      {
+        if(not m_lazy)
+          return;
+        m_configurationMap = m_lazy->expand();
+        m_lazy = boost::none;
+        prv_buildIndex();
+      }
+
+      // Build the alias index of the configuration map from the sections
+      // known to declare aliases.
+      void prv_buildIndex(std::vector<const ConfigType*> const& sections)
+      {
+        m_paths.reset();
+        m_treeIndex = boost::none;
+        m_compactIndex = boost::none;
+        m_lazyIndex = boost::none;
+        m_treeIndex.emplace(TreeAccess(m_configurationMap), sections,
+                            prv_resolver<TreeAccess>());
+        LIBCONFIG_STATISTICS(prv_countAliases();)
+      }
+
+#ifdef LIBCONFIG_ENABLE_STATISTICS
+      void prv_countAliases()
+      {
+        boost::atomic<unsigned long>* counter = &m_counters.aliasIndirections;
+        if(m_treeIndex)
+          m_treeIndex->countAliases(counter);
+        if(m_compactIndex)
+          m_compactIndex->countAliases(counter);
+        if(m_lazyIndex)
+          m_lazyIndex->countAliases(counter);
+      }
+#endif
+
+      // The path index, built on first use.  Lookups are made concurrently,
+      // so it is built under a lock and the index is shared with the
+      // queries using it.
+      boost::shared_ptr<const PathIndex> prv_paths() const
+      {
+        boost::lock_guard<boost::mutex> lock(m_pathsMutex);
+        if(not m_paths) {
+          if(m_compactIndex)
+            m_paths.reset(new PathIndex(m_compactIndex->tree()));
+          else if(m_lazyIndex)
+            m_paths.reset(new PathIndex(m_lazyIndex->tree()));
+          else
+            m_paths.reset(new PathIndex(m_treeIndex->tree()));
         }
-         
-        // Check for the address in an #include_section.
-        boost::optional<std::vector<std::string> > includeSectionKeys = 
-          prv_findIncludeSection(subConfig, keys[keysIdx]);
-        if(includeSectionKeys) 
-        { 
-          return prv_lookupValue(m_configurationMap, value, 
-                   prv_combineKeys(keys, keysIdx + 1, *includeSectionKeys));
+        return m_paths;
+      }
+
+      // Lookup the keys in the compact tree if the configuration has been
+      // compacted, in the lazy tree if it is lazy, otherwise in the
+      // configuration map.
+      template<typename T, typename KeyIterator>
+      bool prv_lookupValue(T& value, KeyIterator key, KeyIterator last,
+                           bool convertToString = false) const
+      {
+        if(m_compactIndex)
+          return prv_lookupValue(*m_compactIndex, value,
+                                 key, last, convertToString);
+        if(m_lazyIndex)
+          return prv_lookupValue(*m_lazyIndex, value,
+                                 key, last, convertToString);
+        return prv_lookupValue(*m_treeIndex, value, 
+                               key, last, convertToString);
+      }
+
+      // Retrieve a value from a configuration item, this is used for the
+      // last key in the configuration address.
+      template<typename Tree, typename T>
+      LookupStatus prv_getValue(const AliasIndex<Tree>& index, 
+                                typename Tree::item_type item,
+                                T& value, bool /* convertToString */) const
+      {
+        if(index.tree().get(item, value))
+          return LookupFound;
+        return prv_mismatch();
+      }
+
+      // Specialization for std::string values, this will look up any references
+      // in the string values.  When resolving a reference any value that is
+      // not a list or a section is converted to a string.
+      template<typename Tree>
+      LookupStatus prv_getValue(const AliasIndex<Tree>& index, 
+                                typename Tree::item_type item,
+                                std::string& value, bool convertToString) const
+      {
+        const Tree& tree = index.tree();
+        double d;
+        int i;
+        boost::int64_t l;
+        bool b;
+        typename Tree::section_type section;
+        if(tree.get(item, value)) {
+          if(not m_resolved)
+            value = prv_resolveReferences(index, value);
         }
+        else if(not convertToString)
+          return prv_mismatch();
+        else if(tree.get(item, i))
+          value = prv_formatNumber("%d", i);
+        else if(tree.get(item, l))
+          value = prv_formatNumber("%lld", static_cast<long long>(l));
+        else if(tree.get(item, d))
+          value = prv_formatNumber("%g", d);
+        else if(tree.get(item, b))
+          value = b ? "1" : "0";
+        else if(tree.section(item, section))
+          value = FormatValue()(ConfigType());
         else
-        {
+          value = FormatValue()(std::vector<boost::none_t>());
+        return LookupFound;
+      }
+
+      // A view of a string value, which must not contain references unless
+      // they have been resolved.
+      template<typename Tree>
+      LookupStatus prv_getValue(const AliasIndex<Tree>& index, 
+                                typename Tree::item_type item,
+                                boost::string_ref& value,
+                                bool /* convertToString */) const
+      {
+        boost::string_ref stored;
+        if(not index.tree().get(item, stored))
+          return prv_mismatch();
+        std::size_t start = 0, end = 0;
+        if(not m_resolved and prv_findReference(stored, start, end))
+          return LookupUnresolved;
+        value = stored;
+        return LookupFound;
+      }
+
+      LookupStatus prv_mismatch() const
+      {
+        LIBCONFIG_STATISTICS(
+          LookupCounters::count(m_counters.typeMismatches);)
+        return LookupTypeMismatch;
+      }
+
+      // Throw the error of a value that was found but could not be read.
+      static void prv_checkValue(LookupStatus status)
+      {
+        if(status == LookupTypeMismatch)
+          throw std::runtime_error("Type requested does not match "
+                                   "the configuration item's type.");
+        if(status == LookupUnresolved)
+          throw std::runtime_error("String value has references, they must "
+                                   "be resolved to view it.");
+      }
+
+      // Format a number as an ostream does by default.  boost::format is not
+      // used as it copies the global locale, which makes threads resolving
+      // references contend on the locale's reference count.
+      template<typename T>
+      static std::string prv_formatNumber(const char* format, T number)
+      {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), format, number);
+        return buffer;
+      }
+
+      // Lookup the item given by the keys and retrieve its value.
+      template<typename Tree, typename T, typename KeyIterator>
+      bool prv_lookupValue(const AliasIndex<Tree>& index, T& value, 
+                           KeyIterator key, KeyIterator last,
+                           bool convertToString = false) const
+      {
+        typename Tree::item_type item = index.find(index.tree().root(),
+                                                   key, last);
+        if(not item)
           return false;
-        }
+        prv_checkValue(prv_getValue(index, item, value, convertToString));
+        return true;
+      }
+
+      template<typename Tree, typename T, typename KeyIterator>
+      LookupStatus prv_tryLookupValue(const AliasIndex<Tree>& index,
+                                      T& value, KeyIterator key,
+                                      KeyIterator last) const
+      {
+        LookupStatus status;
+        typename Tree::item_type item = index.find(index.tree().root(),
+                                                   key, last, status);
+        if(not item)
+          return status;
+        return prv_getValue(index, item, value, false);
       }
 
-      // Look for the give key in the #include_section.
-      boost::optional<std::vector<std::string> > 
-      prv_findIncludeSection(const ConfigType& subConfig, 
-                             const std::string& key)
+      // Find the next '${address}' reference in the value at or after the
+      // start position.  Sets [start, end) to the reference, returns false if
+      // there are no more references.
+      static bool prv_findReference(boost::string_ref value, 
+                                    std::size_t& start, std::size_t& end)
       {
-        if(subConfig.find("$references") != subConfig.end()) 
+        for(start = prv_findOpening(value, start); start != std::string::npos;
+            start = prv_findOpening(value, start + 1))
         {
-          std::string includeSection;
-          std::vector<std::string> includeSectionKeys;
-          if(prv_lookupValue(
-               boost::get<ConfigType>(subConfig.find("$references")->second),
-               includeSection, std::vector<std::string>(1, key)))
-          {
-            return boost::optional<std::vector<std::string> >(
-                       boost::split(includeSectionKeys, 
-                                    includeSection, 
-                                    boost::is_any_of(".")));
-          }
-          else
-          {
-            return boost::none;
+          end = start + 2;
+          while(end < value.size() and 
+                (std::isalnum(static_cast<unsigned char>(value[end])) or
+                 value[end] == '_' or value[end] == '.'))
+            ++end;
+          if(end < value.size() and value[end] == '}') {
+            ++end;
+            return true;
           }
         }
-        return boost::none;
+        return false;
+      }
+
+      // The position of the next "${" at or after the start position.
+      static std::size_t prv_findOpening(boost::string_ref value,
+                                         std::size_t start)
+      {
+        if(start >= value.size())
+          return std::string::npos;
+        std::size_t found = value.substr(start).find("${");
+        return found == boost::string_ref::npos ? found : start + found;
       }
 
-      // Combine the keys from the two addresses.
-      std::vector<std::string> 
-      prv_combineKeys(std::vector<std::string> keys1, 
-                      size_t keys1Idx, std::vector<std::string> keys2)
+      // The value of the address in a reference: the configuration item
+      // converted to a string or else the environment variable.
+      template<typename Tree>
+      std::string prv_referenceValue(const AliasIndex<Tree>& index, 
+                                     const std::string& address) const
       {
-        keys2.insert(keys2.end(), keys1.begin() + keys1Idx, keys1.end());
-        return keys2;
+        LIBCONFIG_STATISTICS(
+          LookupCounters::count(m_counters.referenceResolutions);)
+        std::string resolvedValue;
+        ConfigPath path(address);
+        if(not prv_lookupValue(index, resolvedValue, 
+                               path.begin(), path.end(), true))
+          resolvedValue = prv_environmentValue(address);
+        return resolvedValue;
+      }
+
+      static std::string prv_environmentValue(const std::string& address)
+      {
+        char* env;
+        env = std::getenv(address.c_str());
+        if(env == NULL) {
+          throw std::runtime_error(boost::str(boost::format(
+                  "Unable to resolve reference '%1%' in string value.")
+                  % address));
+        }
+        return env;
       }
 
       // resolve any of the references found the string value.
-      std::string prv_resolveReferences(std::string value)
+      template<typename Tree>
+      std::string prv_resolveReferences(const AliasIndex<Tree>& index, 
+                                        const std::string& value) const
+      {
+        std::size_t start = 0, end = 0, position = 0;
+        if(not prv_findReference(value, start, end))
+          return value;
+
+        std::string result;
+        do {
+          result.append(value, position, start - position);
+          result += prv_referenceValue(index, 
+                      value.substr(start + 2, end - start - 3));
+          position = start = end;
+        } while(prv_findReference(value, start, end));
+        result.append(value, position, std::string::npos);
+        return result;
+      }
+
+      // Find every string value in the section that contains a reference.
+      void prv_collectReferences(ConfigType& section, 
+                                 const std::string& prefix,
+                                 References& references)
       {
-        boost::regex referencePattern("\\$\\{([\\w\\.]*)\\}");
-        boost::sregex_iterator it(value.begin(), value.end(), referencePattern);
-        boost::sregex_iterator end;
-        for(/**/; it != end; ++it) 
+        BOOST_FOREACH(ConfigType::value_type& item, section)
         {
-          std::string address((*it)[1].first, (*it)[1].second);
-          std::string resolvedValue;
-          std::vector<std::string> keys;
-          boost::split(keys, address, boost::is_any_of("."));
+          std::size_t start = 0, end = 0;
+          if(ConfigType* child = boost::get<ConfigType>(&item.second))
+            prv_collectReferences(*child, prefix + item.first + ".", 
+                                  references);
+          else if(std::string* value = boost::get<std::string>(&item.second))
+            if(prv_findReference(*value, start, end))
+              references.insert(std::make_pair(&item.second, 
+                                  Reference(value, prefix + item.first)));
+        }
+      }
 
-          if(not prv_lookupValue(
-                     m_configurationMap, resolvedValue, keys, 0, true))
-          {
-            char* env;
-            env = std::getenv(address.c_str());
-            if(env == NULL) {
-              throw std::runtime_error(boost::str(boost::format(
-                      "Unable to resolve reference '%1%' in string value.")
-                      % address));
-            }
-            resolvedValue = env;
+      // Resolve the references of a string value, first resolving any of the
+      // string values it refers to which contain references themselves.  The
+      // environment variables used are added to the environment.
+      void prv_resolveReference(const AliasIndex<TreeAccess>& index, 
+                                References& references,
+                                Reference& reference,
+                                SnapshotEnvironment& environment)
+      {
+        if(reference.state == Reference::Resolved)
+          return;
+        if(reference.state == Reference::Resolving)
+          throw std::runtime_error(boost::str(boost::format(
+                  "Circular reference in string value '%1%'.")
+                  % reference.address));
+        reference.state = Reference::Resolving;
+
+        const std::string& value = *reference.value;
+        std::string result;
+        std::size_t start = 0, end = 0, position = 0;
+        while(prv_findReference(value, start, end))
+        {
+          result.append(value, position, start - position);
+          std::string address(value, start + 2, end - start - 3);
+          ConfigPath path(address);
+          TreeAccess::item_type item = index.find(index.tree().root(),
+                                                  path.begin(), path.end());
+          References::iterator target = references.find(item);
+          if(target != references.end()) {
+            prv_resolveReference(index, references, target->second,
+                                 environment);
+            result += target->second.resolved;
           }
-          value.replace(it->position(), it->length(), resolvedValue);
+          else if(item) {
+            std::string targetValue;
+            prv_getValue(index, item, targetValue, true);
+            result += targetValue;
+          }
+          else {
+            std::string variable = prv_environmentValue(address);
+            result += variable;
+            environment[address].swap(variable);
+          }
+          position = start = end;
         }
-        return value;
+        result.append(value, position, std::string::npos);
+
+        reference.resolved.swap(result);
+        reference.state = Reference::Resolved;
       }
 
     private:
       // :: ------------------------------------------------------------------
       // :: Members
 
+      // Merges changed files in to its configurations in place.
+      friend class ConfigurationWatcher;
+
+      // Looks up many addresses in one pass.
+      friend class LookupBatch;
+
       ConfigType m_configurationMap;
+      boost::optional<CompactTree> m_compact;
+      boost::optional<LazyTree> m_lazy;
+      bool m_resolved;
+      // The environment variables the references were resolved with.
+      SnapshotEnvironment m_environment;
+      boost::optional<AliasIndex<TreeAccess> > m_treeIndex;
+      boost::optional<AliasIndex<CompactTree> > m_compactIndex;
+      boost::optional<AliasIndex<LazyTree> > m_lazyIndex;
+      mutable boost::shared_ptr<const PathIndex> m_paths;
+      mutable boost::mutex m_pathsMutex;
+#ifdef LIBCONFIG_ENABLE_STATISTICS
+      Statistics m_statistics;
+      mutable LookupCounters m_counters;
+#endif
   };
 
+  // Parse the configuration file and write it to a snapshot file for
+  // Configuration::loadSnapshot.  The sources are taken before the file is
+  // parsed, so a file that changes meanwhile makes the snapshot stale.
+  inline void compileSnapshot(const std::string& configFilename,
+                              const std::string& snapshotFilename,
+                              parse::ParseOptions const& options = 
+                                parse::ParseOptions())
+  {
+    SnapshotSources sources = snapshotSources(configFilename);
+    Configuration configuration(configFilename, options);
+    configuration.saveSnapshot(snapshotFilename, sources);
+  }
+
 } // namespace libconfig
 
 #endif // _libconfig_configuration_included_
@@ -0,0 +1,219 @@
+#ifndef _libconfig_include_included_
+#define _libconfig_include_included_
+
+#include "Parser.h"
+#include "Source.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/foreach.hpp>
+
+namespace libconfig {
+  namespace parse {
+
+    // ========================================================================
+    // An '#include "file"' directive, the path of the included file relative
+    // to the current directory, the path as it is written in the directive
+    // and the offset of the directive in the file that contains it.
+    struct IncludeDirective
+    {
+      IncludeDirective(boost::filesystem::path const& path,
+                       std::string const& name, std::size_t offset)
+        : path(path)
+        , name(name)
+        , offset(offset)
+      {}
+
+      boost::filesystem::path path;
+      std::string name;
+      std::size_t offset;
+    };
+
+    // ========================================================================
+    // A configuration file in an include tree.  The node owns the mapped
+    // contents of the file and remembers where the file was included from,
+    // which together form the source map used to report errors.
+    class SourceNode : boost::noncopyable
+    {
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Types
+
+        typedef boost::shared_ptr<SourceNode> pointer;
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Construction
+
+        SourceNode(boost::filesystem::path const& path,
+                   const SourceNode* parent = NULL,
+                   std::size_t includeOffset = 0,
+                   SourceBuffer::Mode mode = SourceBuffer::Map)
+          : m_path(path)
+          , m_source(path.string(), mode)
+          , m_parent(parent)
+          , m_includeOffset(includeOffset)
+          , m_body(m_source.begin())
+        {
+          Parser parser(m_source.begin(), m_source.end());
+          std::string include;
+          try {
+            for(;;)
+            {
+              std::size_t offset = parser.position() - m_source.begin();
+              if(not parser.include(include))
+                break;
+              m_directives.push_back(IncludeDirective(
+                  (m_path.parent_path() / include).lexically_normal(), 
+                  include, offset));
+            }
+          }
+          catch(ParseError const& e) {
+            throw std::runtime_error(boost::str(boost::format(
+                    "Parsing Includes Failed: expecting %1% at %2%")
+                    % e.expecting() % location(e.position())));
+          }
+          m_body = parser.position();
+        }
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Interface
+
+        boost::filesystem::path const& path() const { return m_path; }
+        SourceBuffer const& source() const { return m_source; }
+
+        // The file that included this one, or NULL for the top level file.
+        const SourceNode* parent() const { return m_parent; }
+
+        // The offset of the '#include' directive in the parent file.
+        std::size_t includeOffset() const { return m_includeOffset; }
+
+        // The start of the configuration items, following the includes.
+        const char* body() const { return m_body; }
+
+        // The '#include' directives at the start of the file.
+        std::vector<IncludeDirective> const& directives() const
+        { return m_directives; }
+
+        // The files included by this one, in the order they are included.
+        // Only filled in for the nodes of a SourceChain.
+        std::vector<pointer> const& includes() const { return m_includes; }
+
+        // Describe the position in this file as 'file:line:column', followed
+        // by the chain of files it was included from.
+        std::string location(const char* position) const
+        {
+          std::size_t line = 1, column = 1;
+          for(const char* p = m_source.begin(); p != position; ++p) {
+            if(*p == '\n') {
+              ++line;
+              column = 1;
+            }
+            else {
+              ++column;
+            }
+          }
+          std::string result = boost::str(boost::format("%1%:%2%:%3%")
+                                 % m_path.string() % line % column);
+          if(m_parent)
+            result += ", included from " + m_parent->location(
+                m_parent->source().begin() + m_includeOffset);
+          return result;
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Members
+
+        friend class SourceChain;
+
+        boost::filesystem::path m_path;
+        SourceBuffer m_source;
+        const SourceNode* m_parent;
+        std::size_t m_includeOffset;
+        const char* m_body;
+        std::vector<IncludeDirective> m_directives;
+        std::vector<pointer> m_includes;
+    };
+
+    // ========================================================================
+    // The include tree of a configuration file.  Every file is opened and
+    // scanned for its '#include' directives once, after which each file's
+    // byte range is parsed in place.  Nothing is ever concatenated, so the
+    // cost of loading is linear in the total size of the files no matter how
+    // deep the includes are nested.
+    class SourceChain : boost::noncopyable
+    {
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Construction
+
+        explicit SourceChain(boost::filesystem::path const& filename,
+                             SourceBuffer::Mode mode = SourceBuffer::Map)
+          : m_mode(mode)
+          , m_size(0)
+        {
+          m_root = prv_open(filename.lexically_normal(), NULL, 0);
+        }
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Interface
+
+        SourceNode const& root() const { return *m_root; }
+
+        // All of the files in the order their items are applied to the
+        // configuration: the included files first, depth first, then the
+        // file that includes them.
+        std::vector<const SourceNode*> const& nodes() const { return m_nodes; }
+
+        // The total number of bytes in all of the files.
+        std::size_t size() const { return m_size; }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Private Member Functions
+
+        // Open the file and recursively every file it includes.
+        SourceNode::pointer prv_open(boost::filesystem::path const& path,
+                                     const SourceNode* parent,
+                                     std::size_t includeOffset)
+        {
+          for(const SourceNode* p = parent; p; p = p->parent()) {
+            if(p->path() == path)
+              throw std::runtime_error(boost::str(boost::format(
+                      "Parsing Includes Failed: '%1%' includes itself at %2%")
+                      % path.string()
+                      % parent->location(parent->source().begin()
+                                         + includeOffset)));
+          }
+
+          SourceNode::pointer node(
+              new SourceNode(path, parent, includeOffset, m_mode));
+          BOOST_FOREACH(IncludeDirective const& include, node->directives()) {
+            node->m_includes.push_back(
+                prv_open(include.path, node.get(), include.offset));
+          }
+
+          m_nodes.push_back(node.get());
+          m_size += node->source().size();
+          return node;
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Members
+
+        SourceBuffer::Mode m_mode;
+        SourceNode::pointer m_root;
+        std::vector<const SourceNode*> m_nodes;
+        std::size_t m_size;
+    };
+
+  } // namespace parse
+} // namespace libconfig
+
+#endif // _libconfig_include_included_
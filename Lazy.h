@@ -0,0 +1,373 @@
+#ifndef _libconfig_lazy_included_
+#define _libconfig_lazy_included_
+
+#include "Types.h"
+#include "Include.h"
+#include "Parser.h"
+#include "View.h"
+
+#include <map>
+#include <vector>
+#include <stdexcept>
+
+#include <boost/atomic.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/filesystem.hpp>
+
+namespace libconfig {
+
+  // ==========================================================================
+  // A configuration that is parsed as it is read.  Loading only scans the
+  // top level of the files, recording the range of the files each section
+  // is declared in without reading it.  The first lookup that enters a
+  // section parses its values and records the ranges of the sections in it
+  // the same way, so the cost of loading a large configuration and reading
+  // a few sections of it is a pass over the characters of the files plus
+  // parsing what is read.
+  //
+  // Sections declared more than once, in one file or in several, are merged
+  // and values replace earlier values as when the whole configuration is
+  // parsed.  An error in a section is reported when the section is first
+  // entered rather than when loading.
+  //
+  // A section is parsed under its own lock, after which it is only read, so
+  // any number of threads can look up in the tree.  Copies of a LazyTree
+  // share the files and the sections parsed so far.  The files are copied
+  // in to memory when loading rather than mapped, so that sections parsed
+  // later read the files as they were loaded even if they change since.
+  //
+  // The read access is the same as TreeAccess and CompactTree provide.
+  class LazyTree
+  {
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Types
+
+      struct Section;
+
+      // An item of a section, either a value or a section.
+      struct Node
+      {
+        ConfigTree value;
+        boost::shared_ptr<Section> section;
+      };
+
+      // The items of one declaration of a section in a file.
+      struct Span
+      {
+        Span(const parse::SourceNode* source, const char* begin,
+             const char* end)
+          : source(source)
+          , begin(begin)
+          , end(end)
+        {}
+
+        const parse::SourceNode* source;
+        const char* begin;
+        const char* end;
+      };
+
+      struct Section : boost::noncopyable
+      {
+        Section()
+          : aliases(false)
+          , parsed(false)
+        {}
+
+        std::vector<Span> spans;
+
+        // True if the section or a section in it declares
+        // '#include_section' aliases.
+        bool aliases;
+
+        // The items, once the section has been parsed.
+        std::map<std::string, Node> items;
+
+        boost::atomic<bool> parsed;
+        boost::mutex mutex;
+      };
+
+      typedef Section* section_type;
+      typedef const Node* item_type;
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Construction
+
+      // Scan the top level of the configuration file and the files it
+      // includes.
+      explicit LazyTree(const std::string& configFilename)
+      {
+        boost::filesystem::path filePath(configFilename);
+        if(filePath.root_directory().empty())
+          filePath = boost::filesystem::current_path() / filePath;
+        m_state.reset(new State(filePath));
+
+        Section& root = m_state->root;
+        BOOST_FOREACH(const parse::SourceNode* node, m_state->chain.nodes()) {
+          root.spans.push_back(Span(node, node->body(), node->source().end()));
+        }
+        root.aliases = true;
+        prv_enter(root);
+      }
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Interface
+
+      section_type root() const { return &m_state->root; }
+
+      // Find the item with the given key in a section, parsing the section
+      // if it is entered for the first time.  Returns NULL if the section
+      // has no such key.
+      item_type find(section_type section, const std::string& key) const
+      {
+        prv_enter(*section);
+        std::map<std::string, Node>::const_iterator it =
+          section->items.find(key);
+        return it == section->items.end() ? NULL : &it->second;
+      }
+
+      bool section(item_type item, section_type& section) const
+      {
+        section = item->section.get();
+        return section != NULL;
+      }
+
+      // Append the keys and items of a section.
+      void items(section_type section,
+                 std::vector<std::pair<std::string, item_type> >& items) const
+      {
+        prv_enter(*section);
+        typedef std::map<std::string, Node>::value_type Item;
+        BOOST_FOREACH(Item const& item, section->items)
+          items.push_back(std::make_pair(item.first, &item.second));
+      }
+
+      // Append the sections that declare '#include_section' aliases.  Only
+      // the sections that hold aliases are entered to find them.
+      void aliasSections(std::vector<section_type>& sections) const
+      {
+        prv_aliasSections(m_state->root, sections);
+      }
+
+      // Numbers are also read as a wider type and an empty list as a list
+      // of any type, see readValue.
+      template<typename T>
+      bool get(item_type item, T& value) const
+      {
+        return not item->section and readValue(item->value, value);
+      }
+
+      // Views of the values stored in the tree.
+      bool get(item_type item, boost::string_ref& value) const
+      {
+        const std::string* t =
+          item->section ? NULL : boost::get<std::string>(&item->value);
+        if(t == NULL)
+          return false;
+        value = *t;
+        return true;
+      }
+
+      template<typename T>
+      bool get(item_type item, ListView<T>& value) const
+      {
+        if(item->section)
+          return false;
+        if(boost::get<std::vector<boost::none_t> >(&item->value) != NULL) {
+          value = ListView<T>();
+          return true;
+        }
+        const std::vector<T>* t = boost::get<std::vector<T> >(&item->value);
+        if(t == NULL)
+          return false;
+        value = ListView<T>(*t);
+        return true;
+      }
+
+      // A section is parsed in full and copied.
+      bool get(item_type item, ConfigType& value) const
+      {
+        if(not item->section)
+          return false;
+        value = prv_expand(*item->section);
+        return true;
+      }
+
+      // Parse the whole configuration.
+      ConfigType expand() const
+      {
+        return prv_expand(m_state->root);
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Types
+
+      struct State : boost::noncopyable
+      {
+        explicit State(boost::filesystem::path const& filePath)
+          : chain(filePath, parse::SourceBuffer::Copy)
+        {}
+
+        parse::SourceChain chain;
+        Section root;
+      };
+
+      typedef std::map<std::string, Node> Items;
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Member Functions
+
+      // Parse the items of a section the first time it is entered.  The
+      // sections in it are skipped, recording where they are, and the
+      // values between them are parsed.  The items are only added once every
+      // declaration of the section has been read, so that an error leaves
+      // the section as it was.
+      void prv_enter(Section& section) const
+      {
+        if(section.parsed.load(boost::memory_order_acquire))
+          return;
+        boost::lock_guard<boost::mutex> lock(section.mutex);
+        if(section.parsed.load(boost::memory_order_relaxed))
+          return;
+
+        Items items;
+        std::string key;
+        BOOST_FOREACH(Span const& span, section.spans)
+        {
+          parse::SourceBuffer const& source = span.source->source();
+          parse::Lexer lexer(source.begin(), span.begin, span.end);
+          try {
+            const char* values = span.begin;
+            for(;;)
+            {
+              char next = lexer.peek();
+              if(next == '\0')
+                break;
+              if(next == '#') {
+                if(not lexer.acceptWord("#include_section"))
+                  lexer.error("'#include_section'");
+                lexer.quotedString(key);
+                if(not lexer.acceptWord("as"))
+                  lexer.error("'as'");
+                lexer.quotedString(key);
+                continue;
+              }
+
+              const char* item = lexer.position();
+              lexer.key(key);
+              if(lexer.accept(':')) {
+                lexer.expect('{');
+                prv_parseValues(span.source, values, item, items);
+                Items::iterator it = items.find(key);
+                if(it == items.end()) {
+                  it = items.insert(std::make_pair(key, Node())).first;
+                  it->second.section.reset(new Section);
+                }
+                else if(not it->second.section) {
+                  lexer.error(boost::str(boost::format(
+                          "'%1%' to be a section") % key));
+                }
+                const char* body = lexer.position();
+                if(lexer.skipSection())
+                  it->second.section->aliases = true;
+                it->second.section->spans.push_back(
+                    Span(span.source, body, lexer.position()));
+                lexer.expect('}');
+                lexer.expect(';');
+                values = lexer.position();
+              }
+              else if(lexer.accept('=')) {
+                lexer.skipValue();
+                lexer.expect(';');
+              }
+              else {
+                lexer.error("'=' or ':'");
+              }
+            }
+            prv_parseValues(span.source, values, span.end, items);
+          }
+          catch(parse::ParseError const& e) {
+            throw std::runtime_error(boost::str(boost::format(
+                    "Parsing Configuration Failed: expecting %1% at %2%")
+                    % e.expecting() % span.source->location(e.position())));
+          }
+        }
+
+        section.items.swap(items);
+        section.parsed.store(true, boost::memory_order_release);
+      }
+
+      // Parse the values between two sections and add them to the items,
+      // replacing any earlier value or section of the same key.  The
+      // '#include_section' aliases are added to the '$references' section.
+      static void prv_parseValues(const parse::SourceNode* source,
+                                  const char* begin, const char* end,
+                                  Items& items)
+      {
+        ConfigType values;
+        parse::TreeBuilder builder(values);
+        parse::Parser(source->source().begin(), begin, end).parse(builder);
+
+        BOOST_FOREACH(ConfigType::value_type& value, values)
+        {
+          Node& node = items[value.first];
+          ConfigType* aliases = boost::get<ConfigType>(&value.second);
+          if(aliases == NULL) {
+            node.section.reset();
+            node.value.swap(value.second);
+            continue;
+          }
+          if(not node.section) {
+            node.section.reset(new Section);
+            node.section->parsed = true;
+          }
+          BOOST_FOREACH(ConfigType::value_type& alias, *aliases)
+            node.section->items[alias.first].value.swap(alias.second);
+        }
+      }
+
+      void prv_aliasSections(Section& section,
+                             std::vector<section_type>& sections) const
+      {
+        prv_enter(section);
+        BOOST_FOREACH(Items::value_type& item, section.items) {
+          if(item.first == "$references")
+            sections.push_back(&section);
+          else if(item.second.section and item.second.section->aliases)
+            prv_aliasSections(*item.second.section, sections);
+        }
+      }
+
+      ConfigType prv_expand(Section& section) const
+      {
+        prv_enter(section);
+        ConfigType configuration;
+        BOOST_FOREACH(Items::value_type const& item, section.items) {
+          if(item.second.section)
+            configuration.insert(ConfigPair(item.first,
+                                   prv_expand(*item.second.section)));
+          else
+            configuration.insert(ConfigPair(item.first, item.second.value));
+        }
+        return configuration;
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Members
+
+      boost::shared_ptr<State> m_state;
+  };
+
+} // namespace libconfig
+
+#endif // _libconfig_lazy_included_
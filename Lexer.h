@@ -0,0 +1,415 @@
+#ifndef _libconfig_lexer_included_
+#define _libconfig_lexer_included_
+
+#include "Number.h"
+
+#include <cstring>
+#include <string>
+#include <stdexcept>
+
+#include <boost/format.hpp>
+
+namespace libconfig {
+  namespace parse {
+
+    // ========================================================================
+    // The exception thrown by the lexer and the parser when the input does
+    // not match the configuration format.
+    class ParseError : public std::runtime_error
+    {
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Construction
+
+        ParseError(const std::string& expecting, const char* position,
+                   std::size_t line, std::size_t column)
+          : std::runtime_error(boost::str(boost::format(
+                "Parsing Configuration Failed: expecting %1% at line %2%, "
+                "column %3%") % expecting % line % column))
+          , m_expecting(expecting)
+          , m_position(position)
+        {}
+
+        ~ParseError() throw() {}
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Interface
+
+        // What the parser was expecting to find.
+        const std::string& expecting() const { return m_expecting; }
+
+        // Where in the input the error was found.
+        const char* position() const { return m_position; }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Members
+
+        std::string m_expecting;
+        const char* m_position;
+    };
+
+    // ========================================================================
+    // Hand written lexer for the configuration format.  The lexer works
+    // directly on a range of characters, it never copies the input and it
+    // never backtracks, every token is classified from its first character.
+    class Lexer
+    {
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Construction
+
+        Lexer(const char* begin, const char* end)
+          : m_begin(begin)
+          , m_pos(begin)
+          , m_end(end)
+        {}
+
+        // Start lexing at 'position', the input before it is only used to
+        // report line numbers.
+        Lexer(const char* begin, const char* position, const char* end)
+          : m_begin(begin)
+          , m_pos(position)
+          , m_end(end)
+        {}
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Interface
+
+        // Skip white space and '//' comments.
+        void skip()
+        {
+          while(m_pos != m_end)
+          {
+            if(prv_isSpace(*m_pos)) {
+              ++m_pos;
+            }
+            else if(*m_pos == '/' and m_pos + 1 != m_end and m_pos[1] == '/') {
+              m_pos = prv_skipLine(m_pos + 2);
+            }
+            else {
+              break;
+            }
+          }
+        }
+
+        // Returns true when only white space and comments remain.
+        bool atEnd()
+        {
+          skip();
+          return m_pos == m_end;
+        }
+
+        // Returns the next significant character or '\0' at the end of the
+        // input.
+        char peek()
+        {
+          skip();
+          return m_pos == m_end ? '\0' : *m_pos;
+        }
+
+        // Consume the character 'c' if it is the next significant character.
+        bool accept(char c)
+        {
+          if(peek() != c)
+            return false;
+          ++m_pos;
+          return true;
+        }
+
+        // Consume the character 'c' or fail.
+        void expect(char c)
+        {
+          if(not accept(c))
+            error(boost::str(boost::format("'%1%'") % c));
+        }
+
+        // Consume the given word if it is the next token.  The word must not
+        // be followed by a key character, i.e. 'as' does not match 'ask'.
+        bool acceptWord(const char* word)
+        {
+          skip();
+          std::size_t length = std::strlen(word);
+          if(std::size_t(m_end - m_pos) < length or
+             std::memcmp(m_pos, word, length) != 0 or
+             (m_pos + length != m_end and prv_isKeyChar(m_pos[length])))
+            return false;
+          m_pos += length;
+          return true;
+        }
+
+        // Read a key, keys are made up of the characters [0-9a-zA-Z_].
+        void key(std::string& key)
+        {
+          skip();
+          const char* start = m_pos;
+          while(m_pos != m_end and prv_isKeyChar(*m_pos))
+            ++m_pos;
+          if(start == m_pos)
+            error("key");
+          key.assign(start, m_pos);
+        }
+
+        // Read a quoted string.  Escape sequences are expanded and adjacent
+        // strings separated by white space or comments are concatenated.
+        void quotedString(std::string& value)
+        {
+          expect('"');
+          value.clear();
+          for(;;)
+          {
+            const char* start = m_pos;
+            while(m_pos != m_end and *m_pos != '"' and *m_pos != '\\')
+              ++m_pos;
+            value.append(start, m_pos);
+
+            if(m_pos == m_end)
+              error("'\"'");
+
+            if(*m_pos == '\\') {
+              m_pos = prv_unescape(m_pos, value);
+              continue;
+            }
+
+            // Closing quote, check for a string continuation.
+            ++m_pos;
+            const char* next = prv_skipInString(m_pos);
+            if(next == m_end or *next != '"')
+              return;
+            m_pos = next + 1;
+          }
+        }
+
+        // Read a quoted string without escape sequences, as used for the
+        // file names of includes.
+        void rawString(std::string& value)
+        {
+          expect('"');
+          const char* start = m_pos;
+          const void* quote = std::memchr(m_pos, '"', m_end - m_pos);
+          if(quote == NULL or quote == start)
+            error("file name");
+          m_pos = static_cast<const char*>(quote);
+          value.assign(start, m_pos++);
+        }
+
+        // Skip a value without reading it, up to the ';' that ends it.  Only
+        // strings and comments are recognised, the value itself is checked
+        // when it is read.  Stops at a brace, which no value contains.
+        void skipValue()
+        {
+          skip();
+          while(m_pos != m_end and *m_pos != ';' and
+                *m_pos != '{' and *m_pos != '}')
+          {
+            if(*m_pos == '"')
+              prv_skipString();
+            else if(*m_pos == '/' and m_pos + 1 != m_end and m_pos[1] == '/')
+              m_pos = prv_skipLine(m_pos + 2);
+            else
+              ++m_pos;
+          }
+        }
+
+        // Skip the items of a section without reading them, up to the '}'
+        // that closes it.  Returns true if the items contain a '#'
+        // directive, i.e. an '#include_section'.
+        bool skipSection()
+        {
+          bool directive = false;
+          std::size_t depth = 0;
+          while(m_pos != m_end)
+          {
+            switch(*m_pos)
+            {
+              case '"':
+                prv_skipString();
+                continue;
+              case '/':
+                if(m_pos + 1 != m_end and m_pos[1] == '/') {
+                  m_pos = prv_skipLine(m_pos + 2);
+                  continue;
+                }
+                break;
+              case '#':
+                directive = true;
+                break;
+              case '{':
+                ++depth;
+                break;
+              case '}':
+                if(depth == 0)
+                  return directive;
+                --depth;
+                break;
+            }
+            ++m_pos;
+          }
+          error("'}'");
+          return directive;
+        }
+
+        // Read a number, see Number.  Returns false without consuming
+        // anything if the next token is not a number.
+        bool number(Number& value)
+        {
+          skip();
+          const char* end = value.scan(m_pos, m_end);
+          if(end == NULL)
+            return false;
+          m_pos = end;
+          return true;
+        }
+
+        // Throw an error describing what was expected at the current
+        // position.
+        void error(const std::string& expecting) const
+        {
+          throw ParseError(expecting, m_pos, line(), column());
+        }
+
+        // The line number of the current position, starting at 1.
+        std::size_t line() const
+        {
+          std::size_t line = 1;
+          for(const char* p = m_begin; p != m_pos; ++p)
+            if(*p == '\n')
+              ++line;
+          return line;
+        }
+
+        // The column of the current position, starting at 1.
+        std::size_t column() const
+        {
+          const char* p = m_pos;
+          while(p != m_begin and p[-1] != '\n')
+            --p;
+          return m_pos - p + 1;
+        }
+
+        const char* position() const { return m_pos; }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Private Member Functions
+
+        static bool prv_isSpace(char c)
+        {
+          return c == ' ' or (c >= '\t' and c <= '\r');
+        }
+
+        static bool prv_isDigit(char c)
+        {
+          return c >= '0' and c <= '9';
+        }
+
+        static bool prv_isKeyChar(char c)
+        {
+          return prv_isDigit(c) or (c >= 'a' and c <= 'z') or
+                 (c >= 'A' and c <= 'Z') or c == '_';
+        }
+
+        static int prv_hexValue(char c)
+        {
+          if(prv_isDigit(c)) return c - '0';
+          if(c >= 'a' and c <= 'f') return c - 'a' + 10;
+          if(c >= 'A' and c <= 'F') return c - 'A' + 10;
+          return -1;
+        }
+
+        // Move past the quoted string at the current position, leaving any
+        // escape sequences as they are.
+        void prv_skipString()
+        {
+          const char* p = m_pos + 1;
+          while(p != m_end and *p != '"') {
+            if(*p == '\\' and p + 1 != m_end)
+              ++p;
+            ++p;
+          }
+          if(p == m_end)
+            error("'\"'");
+          m_pos = p + 1;
+        }
+
+        // Returns the position following the end of the line.
+        const char* prv_skipLine(const char* p) const
+        {
+          const void* eol = std::memchr(p, '\n', m_end - p);
+          return eol ? static_cast<const char*>(eol) + 1 : m_end;
+        }
+
+        // Skip the white space and comments allowed between two adjacent
+        // strings.  Inside a string a comment must be terminated by a new
+        // line.
+        const char* prv_skipInString(const char* p) const
+        {
+          while(p != m_end)
+          {
+            if(prv_isSpace(*p)) {
+              ++p;
+            }
+            else if(*p == '/' and p + 1 != m_end and p[1] == '/') {
+              const void* eol = std::memchr(p, '\n', m_end - p);
+              if(eol == NULL)
+                return p;
+              p = static_cast<const char*>(eol) + 1;
+            }
+            else {
+              break;
+            }
+          }
+          return p;
+        }
+
+        // Expand the escape sequence at 'p' and return the position after
+        // it.  Unknown escape sequences are kept verbatim.
+        const char* prv_unescape(const char* p, std::string& value) const
+        {
+          if(p + 1 == m_end) {
+            value += '\\';
+            return p + 1;
+          }
+          switch(p[1])
+          {
+            case 'a':  value += '\a'; return p + 2;
+            case 'b':  value += '\b'; return p + 2;
+            case 'f':  value += '\f'; return p + 2;
+            case 'n':  value += '\n'; return p + 2;
+            case 'r':  value += '\r'; return p + 2;
+            case 't':  value += '\t'; return p + 2;
+            case 'v':  value += '\v'; return p + 2;
+            case '\\': value += '\\'; return p + 2;
+            case '\'': value += '\''; return p + 2;
+            case '"':  value += '"';  return p + 2;
+            case 'x':
+            {
+              const char* q = p + 2;
+              unsigned int code = 0;
+              while(q != m_end and prv_hexValue(*q) >= 0)
+                code = code * 16 + prv_hexValue(*q++);
+              if(q == p + 2)
+                break;
+              value += static_cast<char>(code);
+              return q;
+            }
+          }
+          value += '\\';
+          return p + 1;
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Members
+
+        const char* m_begin;
+        const char* m_pos;
+        const char* m_end;
+    };
+
+  } // namespace parse
+} // namespace libconfig
+
+#endif // _libconfig_lexer_included_
@@ -3,7 +3,14 @@
 
 #include "Types.h"
 #include "Printing.h"
+#include "Output.h"
 #include "Parse.h"
+#include "Path.h"
+#include "View.h"
+#include "Query.h"
 #include "Configuration.h"
+#include "Batch.h"
+#include "Reload.h"
+#include "Watch.h"
 
 #endif // _libconfig_included_
@@ -0,0 +1,401 @@
+#ifndef _libconfig_number_included_
+#define _libconfig_number_included_
+
+#include "Types.h"
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+namespace libconfig {
+  namespace parse {
+
+    // ========================================================================
+    // A number read from a configuration.  Its type is decided by how it is
+    // written, in the one scan that reads its value, rather than by trying
+    // to read it as each type in turn:
+    //
+    //   12, -7, +3         an int, or a boost::int64_t if it does not fit
+    //   12L, 12LL          a boost::int64_t
+    //   0x1f, -0x1F        an int if it fits, otherwise a boost::int64_t
+    //   0x1fL              a boost::int64_t
+    //   1.5, 1., .5, 2e3   a double, as are 'nan', 'inf' and 'infinity'
+    //
+    // An integer too large for 64 bits is read as a double, unless it has
+    // the L suffix, when it is not a number.  Hexadecimal numbers are read
+    // as the bits they give, so those from 0x8000000000000000 up are
+    // negative.  Doubles are converted from their significant digits and
+    // decimal exponent where that is exact, otherwise with strtod, so they
+    // are always correctly rounded.
+    class Number
+    {
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Types
+
+        // The types of number, each wider than the one before.
+        enum Kind
+        {
+          Int,
+          Int64,
+          Double
+        };
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Construction
+
+        Number()
+          : m_kind(Int)
+          , m_integer(0)
+          , m_real(0)
+        {}
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Interface
+
+        // Read the number at the start of the characters.  Returns the end
+        // of the number, or NULL if they do not start with one.
+        const char* scan(const char* first, const char* last)
+        {
+          const char* p = first;
+          bool negative = false;
+          if(p != last and (*p == '-' or *p == '+'))
+            negative = *p++ == '-';
+
+          if(last - p > 2 and p[0] == '0' and (p[1] == 'x' or p[1] == 'X')
+             and prv_hexValue(p[2]) >= 0)
+            return prv_scanHex(p + 2, last, negative);
+
+          Decimal decimal;
+          const char* end = prv_scanDecimal(p, last, decimal);
+          if(end == NULL) {
+            end = prv_scanSpecial(p, last);
+            if(end == NULL)
+              return NULL;
+            m_kind = Double;
+            m_real = prv_strtod(first, end);
+            return end;
+          }
+
+          if(decimal.integral) {
+            bool suffix = end != last and *end == 'L';
+            if(not decimal.overflow and
+               prv_integer(decimal.mantissa, negative, suffix))
+              return prv_skipSuffix(end, last);
+            if(suffix)
+              return NULL;
+          }
+
+          m_kind = Double;
+          if(prv_fastDecimal(decimal, m_real)) {
+            if(negative)
+              m_real = -m_real;
+          }
+          else {
+            m_real = prv_strtod(first, end);
+          }
+          return end;
+        }
+
+        Kind kind() const { return m_kind; }
+
+        // The value of an Int or an Int64.
+        boost::int64_t integer() const { return m_integer; }
+
+        // The value of a number of any kind as a double.
+        double real() const
+        {
+          return m_kind == Double ? m_real : static_cast<double>(m_integer);
+        }
+
+        // Store the number as its type.
+        void store(ConfigTree& value) const
+        {
+          switch(m_kind)
+          {
+            case Int:    value = static_cast<int>(m_integer); break;
+            case Int64:  value = m_integer; break;
+            case Double: value = m_real; break;
+          }
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Private Types
+
+        // The significant digits and decimal exponent of a number, and
+        // whether it is written as an integer.
+        struct Decimal
+        {
+          Decimal()
+            : mantissa(0)
+            , exponent(0)
+            , overflow(false)
+            , integral(true)
+          {}
+
+          void addDigit(char c)
+          {
+            if(mantissa > (ULLONG_MAX - 9) / 10)
+              overflow = true;
+            else
+              mantissa = mantissa * 10 + (c - '0');
+          }
+
+          unsigned long long mantissa;
+          int exponent;
+          bool overflow;
+          bool integral;
+        };
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Private Member Functions
+
+        static bool prv_isDigit(char c)
+        {
+          return c >= '0' and c <= '9';
+        }
+
+        static int prv_hexValue(char c)
+        {
+          if(prv_isDigit(c)) return c - '0';
+          if(c >= 'a' and c <= 'f') return c - 'a' + 10;
+          if(c >= 'A' and c <= 'F') return c - 'A' + 10;
+          return -1;
+        }
+
+        static const char* prv_skipSuffix(const char* p, const char* last)
+        {
+          if(p != last and *p == 'L') {
+            ++p;
+            if(p != last and *p == 'L')
+              ++p;
+          }
+          return p;
+        }
+
+        // Set the integer of the given magnitude and sign, an Int64 if it
+        // does not fit an int or is 'wide'.  Returns false if it does not
+        // fit 64 bits either.
+        bool prv_integer(unsigned long long magnitude, bool negative,
+                         bool wide)
+        {
+          const unsigned long long largest = 0x7fffffffffffffffULL;
+          if(magnitude > largest + negative)
+            return false;
+          m_integer = negative ?
+            -static_cast<boost::int64_t>(magnitude - 1) - 1 :
+            static_cast<boost::int64_t>(magnitude);
+          m_kind = not wide and m_integer >= INT_MIN and m_integer <= INT_MAX
+                   ? Int : Int64;
+          return true;
+        }
+
+        // Scan the digits of a hexadecimal number, after its '0x'.
+        const char* prv_scanHex(const char* p, const char* last,
+                                bool negative)
+        {
+          unsigned long long value = 0;
+          for(; p != last and prv_hexValue(*p) >= 0; ++p) {
+            if(value >> 60)
+              return NULL;
+            value = value * 16 + prv_hexValue(*p);
+          }
+          bool suffix = p != last and *p == 'L';
+          if(negative) {
+            if(not prv_integer(value, true, suffix))
+              return NULL;
+          }
+          else {
+            m_integer = static_cast<boost::int64_t>(value);
+            m_kind = not suffix and value <= INT_MAX ? Int : Int64;
+          }
+          return prv_skipSuffix(p, last);
+        }
+
+        // Scan '123', '1.5', '1.', '.5' with an optional exponent.  Returns
+        // the end of the number or NULL if there is no number at 'p'.  The
+        // significant digits and the decimal exponent are collected on the
+        // way so that most numbers never need to go through strtod.
+        static const char* prv_scanDecimal(const char* p, const char* last,
+                                           Decimal& decimal)
+        {
+          const char* start = p;
+          while(p != last and prv_isDigit(*p))
+            decimal.addDigit(*p++);
+          bool digits = p != start;
+          if(p != last and *p == '.') {
+            decimal.integral = false;
+            const char* fraction = ++p;
+            while(p != last and prv_isDigit(*p)) {
+              decimal.addDigit(*p++);
+              --decimal.exponent;
+            }
+            digits = digits or p != fraction;
+          }
+          if(not digits)
+            return NULL;
+          if(p != last and (*p == 'e' or *p == 'E')) {
+            const char* q = p + 1;
+            bool negative = false;
+            if(q != last and (*q == '-' or *q == '+'))
+              negative = *q++ == '-';
+            const char* exponentStart = q;
+            int exponent = 0;
+            while(q != last and prv_isDigit(*q)) {
+              if(exponent < 100000)
+                exponent = exponent * 10 + (*q - '0');
+              ++q;
+            }
+            if(q != exponentStart) {
+              decimal.exponent += negative ? -exponent : exponent;
+              decimal.integral = false;
+              p = q;
+            }
+          }
+          return p;
+        }
+
+        // Convert the decimal exactly when both the significant digits and
+        // the power of ten are exactly representable as doubles, in which
+        // case a single multiplication or division is correctly rounded.
+        static bool prv_fastDecimal(const Decimal& decimal, double& value)
+        {
+          static const double powers[] = {
+            1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10,
+            1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21,
+            1e22
+          };
+          if(decimal.overflow or decimal.mantissa > (1ULL << 53) or
+             decimal.exponent < -22 or decimal.exponent > 22)
+            return false;
+          value = static_cast<double>(decimal.mantissa);
+          if(decimal.exponent < 0)
+            value /= powers[-decimal.exponent];
+          else
+            value *= powers[decimal.exponent];
+          return true;
+        }
+
+        // Convert the characters in the range using strtod.
+        static double prv_strtod(const char* first, const char* last)
+        {
+          char buffer[64];
+          std::size_t length = last - first;
+          if(length >= sizeof(buffer))
+            return std::strtod(std::string(first, last).c_str(), NULL);
+          std::memcpy(buffer, first, length);
+          buffer[length] = '\0';
+          return std::strtod(buffer, NULL);
+        }
+
+        // Scan 'nan', 'inf' and 'infinity' ignoring case.
+        static const char* prv_scanSpecial(const char* p, const char* last)
+        {
+          static const char* const words[] = { "infinity", "inf", "nan" };
+          for(std::size_t i = 0; i < sizeof(words) / sizeof(words[0]); ++i)
+          {
+            std::size_t length = std::strlen(words[i]);
+            if(std::size_t(last - p) >= length and
+               strncasecmp(p, words[i], length) == 0)
+              return p + length;
+          }
+          return NULL;
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Members
+
+        Kind m_kind;
+        boost::int64_t m_integer;
+        double m_real;
+    };
+
+    // ========================================================================
+    // The numbers of a list, collected as a list of doubles, which ints and
+    // doubles are both read as exactly, so that any list of numbers can be
+    // looked up or viewed as doubles.  A list of integers where any needs 64
+    // bits is a list of boost::int64_ts instead, as a double cannot hold
+    // every such integer exactly; if the list also holds a double it is a
+    // list of doubles after all.  Integers are only converted to doubles
+    // once a double is added or the list is stored.
+    class NumberList
+    {
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Construction
+
+        NumberList()
+          : m_wide(false)
+          , m_real(false)
+        {}
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Interface
+
+        void add(const Number& number)
+        {
+          if(number.kind() == Number::Double and not m_real)
+            prv_convert();
+          if(m_real) {
+            m_doubles.push_back(number.real());
+          }
+          else {
+            m_integers.push_back(number.integer());
+            m_wide = m_wide or number.kind() == Number::Int64;
+          }
+        }
+
+        // Move the list in to the value, leaving this list empty.
+        void store(ConfigTree& value)
+        {
+          if(m_wide and not m_real) {
+            value = std::vector<boost::int64_t>();
+            boost::get<std::vector<boost::int64_t> >(value).swap(m_integers);
+          }
+          else {
+            if(not m_real)
+              prv_convert();
+            value = std::vector<double>();
+            boost::get<std::vector<double> >(value).swap(m_doubles);
+          }
+          m_wide = false;
+          m_real = false;
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Private Member Functions
+
+        // Move the integers read so far to the doubles.
+        void prv_convert()
+        {
+          m_doubles.assign(m_integers.begin(), m_integers.end());
+          m_integers.clear();
+          m_real = true;
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Members
+
+        bool m_wide;
+        bool m_real;
+        std::vector<boost::int64_t> m_integers;
+        std::vector<double> m_doubles;
+    };
+
+  } // namespace parse
+} // namespace libconfig
+
+#endif // _libconfig_number_included_
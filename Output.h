@@ -0,0 +1,397 @@
+#ifndef _libconfig_output_included_
+#define _libconfig_output_included_
+
+#include "Types.h"
+#include "Printing.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#if __cplusplus >= 201703L and defined(__has_include)
+#  if __has_include(<charconv>)
+#    include <charconv>
+#    if defined(__cpp_lib_to_chars)
+#      define LIBCONFIG_HAS_TO_CHARS
+#    endif
+#  endif
+#endif
+
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/variant.hpp>
+
+namespace libconfig {
+  namespace printing {
+
+    // ========================================================================
+    // A growable buffer that output is written to before it is handed to a
+    // sink.  Without a sink the buffer holds the whole output.  With a file
+    // descriptor or an ostream the buffer is written out whenever it holds
+    // more than a block, when flush() is called and when it is destroyed.
+    // Errors writing to a file descriptor are thrown from flush() but are
+    // ignored by the destructor, so call flush() to see them.
+    class OutputBuffer : boost::noncopyable
+    {
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Types
+
+        static std::size_t const blockSize = 64 * 1024;
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Construction
+
+        // Collect the output in memory.
+        OutputBuffer()
+          : m_fd(-1)
+          , m_stream(NULL)
+        {}
+
+        // Write the output to a file descriptor, which is not closed.
+        explicit OutputBuffer(int fd)
+          : m_fd(fd)
+          , m_stream(NULL)
+        {
+          m_buffer.reserve(blockSize * 2);
+        }
+
+        // Write the output to a stream.
+        explicit OutputBuffer(std::ostream& stream)
+          : m_fd(-1)
+          , m_stream(&stream)
+        {
+          m_buffer.reserve(blockSize * 2);
+        }
+
+        ~OutputBuffer()
+        {
+          try {
+            flush();
+          }
+          catch(std::exception const&) {
+          }
+        }
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Interface
+
+        void append(const char* data, std::size_t size)
+        {
+          m_buffer.append(data, size);
+          prv_spill();
+        }
+
+        void append(const char* text)
+        {
+          append(text, std::strlen(text));
+        }
+
+        void append(std::string const& text)
+        {
+          append(text.data(), text.size());
+        }
+
+        void append(char c)
+        {
+          m_buffer += c;
+          prv_spill();
+        }
+
+        // Append 'count' copies of a character.
+        void fill(char c, std::size_t count)
+        {
+          m_buffer.append(count, c);
+          prv_spill();
+        }
+
+        // The output not yet written to the sink; all of it if there is no
+        // sink.
+        const char* data() const { return m_buffer.data(); }
+        std::size_t size() const { return m_buffer.size(); }
+        std::string const& str() const { return m_buffer; }
+
+        void clear() { m_buffer.clear(); }
+
+        // Write what is buffered to the sink.  Does nothing if there is no
+        // sink.
+        void flush()
+        {
+          if(m_stream != NULL) {
+            m_stream->write(m_buffer.data(), m_buffer.size());
+            m_stream->flush();
+            m_buffer.clear();
+          }
+          else if(m_fd >= 0) {
+            const char* p = m_buffer.data();
+            const char* end = p + m_buffer.size();
+            while(p != end)
+            {
+              ssize_t written = ::write(m_fd, p, end - p);
+              if(written < 0) {
+                if(errno == EINTR)
+                  continue;
+                int error = errno;
+                m_buffer.erase(0, p - m_buffer.data());
+                throw std::runtime_error(boost::str(boost::format(
+                        "Writing Configuration Failed: %1%")
+                        % std::strerror(error)));
+              }
+              p += written;
+            }
+            m_buffer.clear();
+          }
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Private Member Functions
+
+        void prv_spill()
+        {
+          if(m_buffer.size() >= blockSize and (m_fd >= 0 or m_stream != NULL))
+            flush();
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Members
+
+        std::string m_buffer;
+        int m_fd;
+        std::ostream* m_stream;
+    };
+
+    // ========================================================================
+    // Writes a ConfigType object to an OutputBuffer in the configuration
+    // file syntax, so that parsing the output gives back the same values.
+    // Strings are escaped, doubles are written with as many digits as they
+    // need to be read back exactly, and the '$references' sections are
+    // written as the '#include_section' directives they were read from.
+    // Numbers keep their type: doubles always have a fraction or exponent
+    // and 64 bit integers the L suffix.
+    class ConfigWriter : public boost::static_visitor<>
+    {
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Construction
+
+        explicit ConfigWriter(OutputBuffer& output, int indent = 0)
+          : m_output(output)
+          , m_indent(indent)
+        {}
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Interface
+
+        // Write the items of a section.
+        void write(ConfigType const& conf)
+        {
+          BOOST_FOREACH(ConfigType::value_type const& it, conf)
+          {
+            if(it.first == "$references") {
+              prv_writeReferences(it.second);
+              continue;
+            }
+            m_output.fill(' ', m_indent);
+            m_output.append(it.first);
+            boost::apply_visitor(*this, it.second);
+          }
+        }
+
+        // Write a single value
+        template<typename T>
+        void operator()(T const& t)
+        {
+          m_output.append(" = ", 3);
+          prv_writeValue(t);
+          m_output.append(";\n", 2);
+        }
+
+        // Write a list of values
+        template<typename T>
+        void operator()(std::vector<T> const& t)
+        {
+          m_output.append(" = (", 4);
+          for(typename std::vector<T>::const_iterator it = t.begin();
+              it != t.end(); ++it)
+          {
+            if(it != t.begin())
+              m_output.append(", ", 2);
+            prv_writeValue(*it);
+          }
+          m_output.append(");\n", 3);
+        }
+
+        // Write a section
+        void operator()(ConfigType const& conf)
+        {
+          m_output.append(": {\n", 4);
+          m_indent += tabsize;
+          write(conf);
+          m_indent -= tabsize;
+          m_output.fill(' ', m_indent);
+          m_output.append("};\n", 3);
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Private Member Functions
+
+        void prv_writeValue(bool b)
+        {
+          if(b)
+            m_output.append("true", 4);
+          else
+            m_output.append("false", 5);
+        }
+
+        void prv_writeValue(int i)
+        {
+          char buffer[16];
+          m_output.append(buffer, std::snprintf(buffer, sizeof(buffer),
+                                                "%d", i));
+        }
+
+        void prv_writeValue(boost::int64_t i)
+        {
+          char buffer[24];
+          m_output.append(buffer, std::snprintf(buffer, sizeof(buffer),
+                                                "%lldL",
+                                                static_cast<long long>(i)));
+        }
+
+        // The shortest digits that read back as the same double, with
+        // std::to_chars where the library has it, otherwise the shortest of
+        // 15, 16 and 17 significant digits.  Digits alone would be read back
+        // as an integer, so they are followed by '.0'.
+        void prv_writeValue(double d)
+        {
+          char buffer[32];
+#ifdef LIBCONFIG_HAS_TO_CHARS
+          int size = std::to_chars(buffer, buffer + sizeof(buffer), d).ptr
+                     - buffer;
+#else
+          int size = std::snprintf(buffer, sizeof(buffer), "%.15g", d);
+          if(std::isfinite(d) and std::strtod(buffer, NULL) != d) {
+            size = std::snprintf(buffer, sizeof(buffer), "%.16g", d);
+            if(std::strtod(buffer, NULL) != d)
+              size = std::snprintf(buffer, sizeof(buffer), "%.17g", d);
+          }
+#endif
+          m_output.append(buffer, size);
+          int i = 0;
+          while(i != size and (buffer[i] == '-' or
+                               (buffer[i] >= '0' and buffer[i] <= '9')))
+            ++i;
+          if(i == size)
+            m_output.append(".0", 2);
+        }
+
+        // Write a string with the escape sequences the parsers expand.
+        // '\x' reads every hex digit that follows it, so a string is closed
+        // and continued after a '\x' escape followed by a hex digit.
+        void prv_writeValue(std::string const& s)
+        {
+          static const char hex[] = "0123456789abcdef";
+          m_output.append('"');
+          const char* start = s.data();
+          const char* end = start + s.size();
+          for(const char* p = start; p != end; ++p)
+          {
+            unsigned char c = *p;
+            if(c >= 0x20 and c != 0x7f and c != '"' and c != '\\')
+              continue;
+            m_output.append(start, p - start);
+            start = p + 1;
+            char escape[4] = { '\\', 0, 0, 0 };
+            switch(c)
+            {
+              case '\a': escape[1] = 'a';  break;
+              case '\b': escape[1] = 'b';  break;
+              case '\f': escape[1] = 'f';  break;
+              case '\n': escape[1] = 'n';  break;
+              case '\r': escape[1] = 'r';  break;
+              case '\t': escape[1] = 't';  break;
+              case '\v': escape[1] = 'v';  break;
+              case '\\': escape[1] = '\\'; break;
+              case '"':  escape[1] = '"';  break;
+              default:
+                escape[1] = 'x';
+                escape[2] = hex[c >> 4];
+                escape[3] = hex[c & 0xf];
+                m_output.append(escape, 4);
+                if(start != end and std::isxdigit(
+                        static_cast<unsigned char>(*start)))
+                  m_output.append("\" \"", 3);
+                continue;
+            }
+            m_output.append(escape, 2);
+          }
+          m_output.append(start, end - start);
+          m_output.append('"');
+        }
+
+        // An empty list has no type.
+        void prv_writeValue(boost::none_t) {}
+
+        // Write the aliases of a '$references' section.
+        void prv_writeReferences(ConfigTree const& references)
+        {
+          const ConfigType* aliases = boost::get<ConfigType>(&references);
+          if(aliases == NULL)
+            return;
+          BOOST_FOREACH(ConfigType::value_type const& alias, *aliases)
+          {
+            const std::string* address =
+              boost::get<std::string>(&alias.second);
+            if(address == NULL)
+              continue;
+            m_output.fill(' ', m_indent);
+            m_output.append("#include_section ", 17);
+            prv_writeValue(*address);
+            m_output.append(" as ", 4);
+            prv_writeValue(alias.first);
+            m_output.append('\n');
+          }
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Members
+
+        OutputBuffer& m_output;
+        int m_indent;
+    };
+
+    // Write the configuration to the output.
+    inline void writeConfig(ConfigType const& conf, OutputBuffer& output)
+    {
+      ConfigWriter(output).write(conf);
+    }
+
+    // The configuration as a string in the configuration file syntax.
+    inline std::string configToString(ConfigType const& conf)
+    {
+      OutputBuffer output;
+      writeConfig(conf, output);
+      return output.str();
+    }
+
+  } // namespace printing
+} // namespace libconfig
+
+#endif // _libconfig_output_included_
@@ -2,13 +2,17 @@
 #define _libconfig_parse_included_
 
 #include "Types.h"
+#include "Number.h"
+#include "Include.h"
+#include "Cache.h"
+#include "Statistics.h"
 
 #include <fstream>
+#include <algorithm>
 
 #define BOOST_SPIRIT_DEBUG
 
 #define BOOST_SPIRIT_USE_PHOENIX_V3
-#include <boost/phoenix/function/adapt_callable.hpp>
 
 #include <boost/config/warning_disable.hpp>
 #include <boost/spirit/include/qi.hpp>
@@ -18,9 +22,55 @@
 #include <boost/spirit/include/phoenix_fusion.hpp>
 #include <boost/spirit/include/phoenix_stl.hpp>
 #include <boost/spirit/include/phoenix_object.hpp>
+#include <boost/spirit/include/phoenix_bind.hpp>
 #include <boost/fusion/include/adapt_struct.hpp>
 #include <boost/fusion/include/std_pair.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+// ============================================================================
+// Spirit copies the attribute of each item it parses in to the section the
+// item belongs to, and converts the attribute of a section rule to the item
+// attribute by copying, so a section would be copied once for every level
+// it is nested in.  These move them instead.
+namespace boost { namespace spirit { namespace traits {
+
+  // The item is the value the kleene star parsed in to, which is discarded
+  // after it has been added, so it is moved in to the section.
+  template<>
+  struct push_back_container<libconfig::ConfigType, libconfig::ConfigPair>
+  {
+    static bool call(libconfig::ConfigType& section,
+                     libconfig::ConfigPair const& item)
+    {
+      libconfig::ConfigPair& parsed = const_cast<libconfig::ConfigPair&>(item);
+      section.splice(parsed.first, parsed.second);
+      return true;
+    }
+  };
+
+  // A parsed section moved in to an item.
+  template<>
+  struct transform_attribute<
+      libconfig::ConfigPair,
+      std::pair<libconfig::ConfigKey, libconfig::ConfigType>, qi::domain>
+  {
+    typedef std::pair<libconfig::ConfigKey, libconfig::ConfigType> type;
+
+    static type pre(libconfig::ConfigPair&) { return type(); }
+
+    static void post(libconfig::ConfigPair& item, type& section)
+    {
+      item.first.swap(section.first);
+      item.second = libconfig::ConfigType();
+      boost::get<libconfig::ConfigType>(item.second).swap(section.second);
+    }
+
+    static void fail(libconfig::ConfigPair&) {}
+  };
+
+}}} // namespace boost::spirit::traits
 
 
 namespace libconfig {
@@ -31,15 +81,43 @@ namespace libconfig {
     namespace qi = boost::spirit::qi;
     namespace ascii = boost::spirit::ascii;
 
-    // Forward declaration of the expand includes function for boost phoenix
-    // adapt
-    std::string _expandIncludes(std::string, std::string);
-    
-    // Adapt the expandIncludes funtion to with with boost phoenix, this allows
-    // for calling the expandIncludes function in an boost spirit qi action.
-    BOOST_PHOENIX_ADAPT_FUNCTION(std::string, expandIncludes, 
-                                 _expandIncludes, 2);
-    
+    // =======================================================================
+    // Parser of a Number, which reads and classifies it in one scan rather
+    // than trying it as a double and again as an int.  The input must be
+    // contiguous characters, as it is for every file parsed.
+    struct number_parser : qi::primitive_parser<number_parser>
+    {
+      template<typename Context, typename Iterator>
+      struct attribute
+      {
+        typedef Number type;
+      };
+
+      template<typename Iterator, typename Context, typename Skipper,
+               typename Attribute>
+      bool parse(Iterator& first, Iterator const& last, Context&,
+                 Skipper const& skipper, Attribute& attribute) const
+      {
+        qi::skip_over(first, last, skipper);
+        if(first == last)
+          return false;
+        const char* begin = &*first;
+        Number number;
+        const char* end = number.scan(begin, begin + (last - first));
+        if(end == NULL)
+          return false;
+        first += end - begin;
+        boost::spirit::traits::assign_to(number, attribute);
+        return true;
+      }
+
+      template<typename Context>
+      boost::spirit::info what(Context&) const
+      {
+        return boost::spirit::info("number");
+      }
+    };
+
     // =======================================================================
     // Grammar definition of the white space and comment skipper
     template<typename Iterator>
@@ -86,80 +164,6 @@ namespace libconfig {
     };
 
 
-    // ========================================================================
-    // Grammar definition for parsing the include files
-    template<typename Iterator, typename Skipper = config_skipper<Iterator> >
-    struct include_grammar
-      : qi::grammar<Iterator, std::string(), Skipper>
-    {
-      // :: ------------------------------------------------------------------
-      // :: Construction
-      
-      include_grammar(std::string _base_dir)
-        : include_grammar::base_type(config_file, "expand the includes")
-        , base_dir(_base_dir)
-      {
-        using qi::lit;
-        using qi::skip;
-        using qi::eol;
-        using qi::lexeme;
-        using qi::no_skip;
-        using qi::on_error;
-        using qi::fail;
-        using ascii::space;
-        using ascii::char_;
-        using namespace qi::labels;
-        using phoenix::construct;
-        using phoenix::val;
-
-        quoted_string %= 
-                lexeme['"' >> +(char_ - '"') >> '"'] 
-        ;
-
-        include = 
-                lit("#include")       
-            >   quoted_string [_val += expandIncludes(base_dir, _1)]
-        ;
-
-        config_file %= 
-                *include
-            >>  no_skip[*char_]
-        ;
-
-        include.name("include");
-        quoted_string.name("quoted_string");
-        config_file.name("config_file");
-        
-        on_error<fail>
-        (
-            config_file
-          , std::cout
-                << val("Error! Expecting ")
-                << _4                             // what failed?
-                << val(" here: \"")
-                << construct<std::string>(_3, _2) // iterators to error-pos, end
-                << val("\"")
-                << std::endl
-        );
-
-        // Uncomment to disable debugging
-        //BOOST_SPIRIT_DEBUG_NODE(include);
-        //BOOST_SPIRIT_DEBUG_NODE(quoted_string);
-        //BOOST_SPIRIT_DEBUG_NODE(config_file);
-
-      }
-
-      // :: -------------------------------------------------------------------
-      // :: Members
-
-      qi::rule<Iterator, std::string(), Skipper> include;
-      qi::rule<Iterator, std::string(), Skipper> quoted_string;
-      qi::rule<Iterator, std::string(), Skipper> config_file;
-
-      std::string base_dir;
-    };
-
-
     // ========================================================================
     // Grammar definition for parsing the configuration format
     template <typename Iterator, typename Skipper = config_skipper<Iterator> >
@@ -179,8 +183,7 @@ namespace libconfig {
         using qi::lexeme;
         using qi::on_error;
         using qi::fail;
-        using qi::double_;
-        using qi::int_;
+        using qi::eps;
         using qi::true_;
         using qi::false_;
         using qi::attr;
@@ -213,8 +216,8 @@ namespace libconfig {
                 key
             >> !lit(':')
             >   lit('=')
-            >   ( unesc_str | double_ | int_ | quoted_string_list | 
-                  double_list | int_list | bool_type | empty_list )
+            >   ( unesc_str | number | quoted_string_list | 
+                  number_list | bool_type | empty_list )
             >   lit(';')
         ;
 
@@ -263,16 +266,20 @@ namespace libconfig {
             >   lit(')')
         ;
 
-        double_list %=
-                lit('(')
-            >>  double_ % ','
-            >   lit(')')
+        number_token %=
+                number_parser()
         ;
 
-        int_list %=
+        number =
+                number_token [ phoenix::bind(&Number::store, _1, _val) ]
+        ;
+
+        // A list of doubles, or of boost::int64_ts, see NumberList.
+        number_list =
                 lit('(')
-            >>  int_ % ','
+            >>  number_token [ phoenix::bind(&NumberList::add, _a, _1) ] % ','
             >   lit(')')
+            >   eps [ phoenix::bind(&NumberList::store, _a, _val) ]
         ;
 
         empty_list %= 
@@ -305,8 +312,8 @@ namespace libconfig {
         key_value_pair.name("key_value_pair");
         quoted_string.name("quoted_string");
         quoted_string_list.name("quoted_string_list");
-        double_list.name("double_list");
-        int_list.name("int_list");
+        number.name("number");
+        number_list.name("number_list");
         start_tag.name("start_tag");
         end_tag.name("end_tag");
         include_section.name("include_section");
@@ -347,8 +354,10 @@ namespace libconfig {
 
       qi::rule<Iterator, std::string(), Skipper> quoted_string;
       qi::rule<Iterator, std::vector<std::string>(), Skipper> quoted_string_list;
-      qi::rule<Iterator, std::vector<double>(), Skipper> double_list;
-      qi::rule<Iterator, std::vector<int>(), Skipper> int_list;
+      qi::rule<Iterator, Number(), Skipper> number_token;
+      qi::rule<Iterator, ConfigTree(), Skipper> number;
+      qi::rule<Iterator, ConfigTree(), qi::locals<NumberList>, Skipper>
+        number_list;
       qi::rule<Iterator, std::vector<boost::none_t>(), Skipper> empty_list;
       qi::rule<Iterator, bool(), Skipper> bool_type;
 
@@ -362,75 +371,399 @@ namespace libconfig {
     // an std::string
     std::string fileToString(std::string filename)
     {
-      std::ifstream in(filename.c_str(), std::ios_base::in);
+      SourceBuffer source(filename);
+      return std::string(source.begin(), source.end());
+    }
     
-      if (!in) {
-          throw std::runtime_error("Could not open input file.");
+    // ========================================================================
+    // The parsers available for parsing the configuration format.
+    enum ParserType
+    {
+      SpiritParser,   // The boost spirit config_grammar
+      DescentParser   // The hand written recursive descent parser
+    };
+
+    // ========================================================================
+    // Options controlling how a configuration file is parsed.
+    struct ParseOptions
+    {
+      ParseOptions(ParserType parser = SpiritParser)
+        : parser(parser)
+        , cacheIncludes(false)
+        , threads(1)
+        , lazy(false)
+      {}
+
+      ParserType parser;
+
+      // Keep the parsed files in the process wide FragmentCache and reuse
+      // them for as long as the files are unchanged on disk.
+      bool cacheIncludes;
+
+      // The number of threads used to parse the included files.  With more
+      // than one thread the include tree is discovered first and the files
+      // are then parsed concurrently and merged in their textual order.
+      std::size_t threads;
+
+      // Only scan the structure of the files when a Configuration is loaded
+      // and parse each section the first time a lookup enters it, with the
+      // descent parser.  See LazyTree.
+      bool lazy;
+    };
+
+    // ========================================================================
+    // Parse the configuration items of one file in the include tree with the
+    // descent parser, reporting them to the handler.
+    template<typename Handler>
+    void _scanSource(SourceNode const& node, Handler& handler)
+    {
+      SourceBuffer const& source = node.source();
+      try {
+        Parser(source.begin(), node.body(), source.end()).parse(handler);
+      }
+      catch(ParseError const& e) {
+        throw std::runtime_error(boost::str(boost::format(
+                "Parsing Configuration Failed: expecting %1% at %2%")
+                % e.expecting() % node.location(e.position())));
       }
-    
-      std::string storage; // We will read the contents here.
-      in.unsetf(std::ios::skipws); // No white space skipping!
-      std::copy(
-          std::istream_iterator<char>(in),
-          std::istream_iterator<char>(),
-          std::back_inserter(storage));
-    
-      return storage;
     }
-    
+
     // ========================================================================
-    // Given the config file return a string representation of the file with 
-    // all of the includes expanded.
-    std::string _expandIncludes(std::string baseDir, std::string filename)
+    // Parse the configuration items of one file in the include tree into
+    // the configuration.
+    void _parseSource(SourceNode const& node, ParseOptions const& options,
+                      ConfigType& configuration)
     {
-      boost::filesystem::path filePath;
-      filePath /= baseDir;
-      filePath /= filename; 
+      SourceBuffer const& source = node.source();
 
-      std::string storage = fileToString(filePath.string());
-      std::string result;
+      if(options.parser == DescentParser) {
+        TreeBuilder builder(configuration);
+        _scanSource(node, builder);
+        return;
+      }
 
-      typedef include_grammar<std::string::const_iterator> include_grammar;
-      typedef config_skipper<std::string::const_iterator> config_skipper;
+      typedef config_grammar<const char*> config_grammar;
+      typedef config_skipper<const char*> config_skipper;
+
+      const char* iter = node.body();
+      const char* end = source.end();
+      config_grammar grammar; 
+      config_skipper skipper; 
+      bool r = phrase_parse(iter, end, grammar, skipper, configuration);
 
-      std::string::const_iterator iter = storage.begin();
-      std::string::const_iterator end = storage.end();
-      include_grammar grammar(filePath.parent_path().string());
-      config_skipper skipper;
-      bool r = phrase_parse(iter, end, grammar, skipper, result);
-      
       if (not r or iter != end)
-        throw std::runtime_error("Parsing Includes Failed");
+        throw std::runtime_error("Parsing Configuration Failed at " 
+                                 + node.location(iter));
+    }
 
-      return result;
+    // ========================================================================
+    // Merge the items of a parsed file into the configuration.  The items
+    // are copied, the fragment may be shared through the cache.
+    void _mergeFragment(ConfigType const& fragment, ConfigType& configuration)
+    {
+      if(configuration.empty()) {
+        configuration = fragment;
+        return;
+      }
+      BOOST_FOREACH(ConfigType::value_type const& value, fragment) {
+        configuration.insert(configuration.end(), value);
+      }
+    }
+
+    // Merge the items of a parsed file into the configuration by swapping
+    // them into place, leaving the fragment in an unspecified state.  Has
+    // the same semantics as inserting the items one by one.
+    void _spliceFragment(ConfigType& fragment, ConfigType& configuration)
+    {
+      if(configuration.empty()) {
+        configuration.swap(fragment);
+        return;
+      }
+      BOOST_FOREACH(ConfigType::value_type& value, fragment) {
+        ConfigType::iterator it = configuration.find(value.first);
+        ConfigType* section = boost::get<ConfigType>(&value.second);
+        if(it == configuration.end()) {
+          it = configuration.insert(ConfigPair(value.first, ConfigTree())).first;
+          it->second.swap(value.second);
+        }
+        else if(section == NULL) {
+          it->second.swap(value.second);
+        }
+        else {
+          ConfigType* existing = boost::get<ConfigType>(&it->second);
+          if(existing == NULL)
+            throw std::runtime_error(boost::str(boost::format(
+                    "Parsing Configuration Failed: '%1%' is not a section")
+                    % value.first));
+          _spliceFragment(*section, *existing);
+        }
+      }
     }
 
     // ========================================================================
-    // Parse the config file in to a ConfigType object
-    ConfigType parseConfigFile(std::string filename)
+    // Loads a configuration file through the fragment cache and/or with
+    // several threads.  The include tree is discovered first, using cached
+    // fragments where possible, then the files that still need parsing are
+    // parsed, concurrently if allowed, and finally the fragments are merged
+    // in the order the files are included.
+    class FragmentLoader : boost::noncopyable
+    {
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Construction
+
+        explicit FragmentLoader(ParseOptions const& options,
+                                Statistics* statistics = NULL)
+          : m_options(options)
+          , m_statistics(statistics)
+          , m_next(0)
+        {}
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Interface
+
+        void load(boost::filesystem::path const& filePath, 
+                  ConfigType& configuration)
+        {
+          LIBCONFIG_STATISTICS(Stopwatch stopwatch;)
+          std::vector<std::string> stack;
+          prv_discover(filePath.lexically_normal(), NULL, 0, stack);
+          LIBCONFIG_STATISTICS(double include = stopwatch.lap();)
+
+          std::size_t threads = std::min(m_options.threads, m_pending.size());
+          if(threads > 1) {
+            boost::thread_group group;
+            for(std::size_t i = 0; i < threads; ++i)
+              group.create_thread(
+                  boost::bind(&FragmentLoader::prv_work, this));
+            group.join_all();
+          }
+          else {
+            prv_work();
+          }
+          if(not m_error.empty())
+            throw std::runtime_error(m_error);
+          LIBCONFIG_STATISTICS(double parse = stopwatch.lap();)
+
+          BOOST_FOREACH(std::size_t index, m_order) {
+            File& file = m_files[index];
+            if(file.cached)
+              _mergeFragment(file.cached->configuration, configuration);
+            else if(--file.uses == 0 and not m_options.cacheIncludes)
+              _spliceFragment(file.parsed->configuration, configuration);
+            else
+              _mergeFragment(file.parsed->configuration, configuration);
+          }
+
+#ifdef LIBCONFIG_ENABLE_STATISTICS
+          if(m_statistics != NULL) {
+            m_statistics->includeSeconds += include;
+            m_statistics->parseSeconds += parse;
+            m_statistics->mergeSeconds += stopwatch.lap();
+            BOOST_FOREACH(File const& file, m_files)
+              m_statistics->files.push_back(FileStatistics(file.path,
+                  file.node ? file.node->source().size() : file.key.size,
+                  file.seconds));
+          }
+#endif
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Private Types
+
+        // A distinct file of the include tree.
+        struct File
+        {
+          File()
+            : uses(0)
+            , seconds(0)
+          {}
+
+          std::string path;
+          FragmentKey key;
+          boost::shared_ptr<SourceNode> node;
+          FragmentCache::pointer cached;
+          boost::shared_ptr<Fragment> parsed;
+          std::size_t uses;
+          double seconds;
+        };
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Private Member Functions
+
+        // Walk the include tree, recording the order the files are applied
+        // in and opening every file that is not cached.  Files are opened
+        // and their includes resolved by the path they are included by, as
+        // when they are not cached, the canonical path of the file is only
+        // used to find it in the cache.
+        void prv_discover(boost::filesystem::path const& path, 
+                          const SourceNode* parent, std::size_t offset,
+                          std::vector<std::string>& stack)
+        {
+          std::string name = path.string();
+          if(std::find(stack.begin(), stack.end(), name) != stack.end())
+            throw std::runtime_error(boost::str(boost::format(
+                    "Parsing Includes Failed: '%1%' includes itself")
+                    % name));
+
+          std::map<std::string, std::size_t>::iterator it = 
+            m_index.find(name);
+          if(it == m_index.end()) {
+            it = m_index.insert(std::make_pair(name, m_files.size())).first;
+            m_files.push_back(File());
+            File& file = m_files.back();
+            file.path = name;
+            if(m_options.cacheIncludes) {
+              file.key = FragmentKey(path);
+              file.cached = FragmentCache::instance().find(file.key);
+            }
+            if(not file.cached) {
+              file.node.reset(new SourceNode(path, parent, offset));
+              m_pending.push_back(it->second);
+            }
+          }
+
+          // Copy what is needed from the file, discovering the includes may
+          // add files and invalidate references into m_files.
+          std::size_t index = it->second;
+          std::vector<IncludeDirective> includes = m_files[index].cached
+            ? prv_includes(m_files[index].cached->includes, path)
+            : m_files[index].node->directives();
+          const SourceNode* node = m_files[index].node.get();
+
+          stack.push_back(name);
+          BOOST_FOREACH(IncludeDirective const& include, includes) {
+            prv_discover(include.path, node, include.offset, stack);
+          }
+          stack.pop_back();
+
+          ++m_files[index].uses;
+          m_order.push_back(index);
+        }
+
+        // The includes of a cached file, resolved against the path it is
+        // included by now rather than the path it was first parsed by.
+        static std::vector<IncludeDirective> prv_includes(
+            std::vector<IncludeDirective> const& cached,
+            boost::filesystem::path const& path)
+        {
+          std::vector<IncludeDirective> includes;
+          BOOST_FOREACH(IncludeDirective const& include, cached) {
+            includes.push_back(IncludeDirective(
+                (path.parent_path() / include.name).lexically_normal(),
+                include.name, include.offset));
+          }
+          return includes;
+        }
+
+        // Parse pending files until there are none left.  Runs on each of
+        // the threads.
+        void prv_work()
+        {
+          for(;;)
+          {
+            File* file;
+            {
+              boost::lock_guard<boost::mutex> lock(m_mutex);
+              if(m_next == m_pending.size() or not m_error.empty())
+                return;
+              file = &m_files[m_pending[m_next++]];
+            }
+
+            try {
+              LIBCONFIG_STATISTICS(Stopwatch stopwatch;)
+              boost::shared_ptr<Fragment> parsed(new Fragment);
+              parsed->includes = file->node->directives();
+              _parseSource(*file->node, m_options, parsed->configuration);
+              if(m_options.cacheIncludes)
+                FragmentCache::instance().insert(file->key, parsed);
+              file->parsed = parsed;
+              LIBCONFIG_STATISTICS(file->seconds = stopwatch.lap();)
+            }
+            catch(std::exception const& e) {
+              boost::lock_guard<boost::mutex> lock(m_mutex);
+              if(m_error.empty())
+                m_error = e.what();
+            }
+          }
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Members
+
+        ParseOptions m_options;
+        Statistics* m_statistics;
+        std::vector<File> m_files;
+        std::map<std::string, std::size_t> m_index;
+        std::vector<std::size_t> m_order;
+        std::vector<std::size_t> m_pending;
+
+        boost::mutex m_mutex;
+        std::size_t m_next;
+        std::string m_error;
+    };
+
+    // ========================================================================
+    // Parse the config file in to a ConfigType object.  The time taken is
+    // added to the statistics if they are given and enabled.
+    ConfigType parseConfigFile(std::string filename, 
+                               ParseOptions const& options = ParseOptions(),
+                               Statistics* statistics = NULL)
     {
       ConfigType configuration;
-    
-      std::string storage = 
-          boost::filesystem::path(filename).root_directory().empty()
-        ? _expandIncludes(boost::filesystem::current_path().string(), filename)
-        : _expandIncludes("", filename);
-    
-      typedef config_grammar<std::string::const_iterator> config_grammar;
-      typedef config_skipper<std::string::const_iterator> config_skipper;
-    
-      std::string::const_iterator iter = storage.begin();
-      std::string::const_iterator end = storage.end();
-      config_grammar grammar; 
-      config_skipper skipper; 
-      bool r = phrase_parse(iter, end, grammar, skipper, configuration);
-      
-      if (not r or iter != end)
-        throw std::runtime_error("Parsing Configuration Failed");
+
+      boost::filesystem::path filePath(filename);
+      if(filePath.root_directory().empty())
+        filePath = boost::filesystem::current_path() / filePath;
+
+      if(options.cacheIncludes or options.threads > 1) {
+        FragmentLoader(options, statistics).load(filePath, configuration);
+        return configuration;
+      }
+
+      LIBCONFIG_STATISTICS(Stopwatch stopwatch;)
+      SourceChain chain(filePath);
+      LIBCONFIG_STATISTICS(if(statistics != NULL)
+                             statistics->includeSeconds += stopwatch.lap();)
+      BOOST_FOREACH(const SourceNode* node, chain.nodes()) {
+        _parseSource(*node, options, configuration);
+#ifdef LIBCONFIG_ENABLE_STATISTICS
+        if(statistics != NULL) {
+          double seconds = stopwatch.lap();
+          statistics->parseSeconds += seconds;
+          statistics->files.push_back(FileStatistics(node->path().string(),
+              node->source().size(), seconds));
+        }
+#endif
+      }
 
       return configuration;
     }
 
+    // ========================================================================
+    // Parse the config file with the descent parser, reporting the items of
+    // each file to the handler in the order the files are merged instead of
+    // building a ConfigType.  See TreeBuilder for the functions a handler
+    // provides.  The files are mapped rather than read, so the memory used
+    // does not grow with the size of the input, only with how deeply
+    // sections are nested.
+    template<typename Handler>
+    void scanConfigFile(std::string filename, Handler& handler)
+    {
+      boost::filesystem::path filePath(filename);
+      if(filePath.root_directory().empty())
+        filePath = boost::filesystem::current_path() / filePath;
+
+      SourceChain chain(filePath);
+      BOOST_FOREACH(const SourceNode* node, chain.nodes()) {
+        _scanSource(*node, handler);
+      }
+    }
+
   } // namespace parse
 } // namespace libconfig
 
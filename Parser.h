@@ -0,0 +1,273 @@
+#ifndef _libconfig_parser_included_
+#define _libconfig_parser_included_
+
+#include "Types.h"
+#include "Lexer.h"
+
+namespace libconfig {
+  namespace parse {
+
+    // ========================================================================
+    // The handler of the parser events that builds the ConfigType tree.
+    // Sections are created in place the first time they are seen and merged
+    // with when seen again, and a value replaces any earlier value of the
+    // same key.
+    //
+    // A Parser handler provides the same four functions:
+    //
+    //   bool beginSection(const std::string& key)
+    //   void endSection()
+    //   void value(const std::string& key, ConfigTree& value)
+    //   bool includeSection(const std::string& address,
+    //                       const std::string& alias)
+    //
+    // The value may be swapped out of by the handler.  beginSection and
+    // includeSection return false if the item can not be added to the
+    // current section because its key is already a value, which the parser
+    // reports as an error.
+    class TreeBuilder
+    {
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Construction
+
+        explicit TreeBuilder(ConfigType& config)
+        {
+          m_sections.push_back(&config);
+        }
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Interface
+
+        bool beginSection(const std::string& key)
+        {
+          ConfigType& section = *m_sections.back();
+          ConfigType::iterator it = section.find(key);
+          if(it == section.end())
+            it = section.insert(ConfigPair(key, ConfigType())).first;
+          ConfigType* subSection = boost::get<ConfigType>(&it->second);
+          if(subSection == NULL)
+            return false;
+          m_sections.push_back(subSection);
+          return true;
+        }
+
+        void endSection()
+        {
+          m_sections.pop_back();
+        }
+
+        void value(const std::string& key, ConfigTree& value)
+        {
+          (*m_sections.back())[key].swap(value);
+        }
+
+        // The include section is stored in the '$references' section as
+        // alias = "address".
+        bool includeSection(const std::string& address,
+                            const std::string& alias)
+        {
+          if(not beginSection("$references"))
+            return false;
+          (*m_sections.back())[alias] = address;
+          endSection();
+          return true;
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Members
+
+        std::vector<ConfigType*> m_sections;
+    };
+
+    // ========================================================================
+    // Hand written recursive descent parser for the configuration format.
+    // The parser reports what it finds to a handler as it goes, so that the
+    // input can be scanned in constant memory.  Parsing into a ConfigType
+    // uses the TreeBuilder handler and produces the same ConfigType as the
+    // spirit config_grammar, but sections are parsed straight into their
+    // place in the tree so nothing is copied or merged after the fact.
+    class Parser
+    {
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Construction
+
+        Parser(const char* begin, const char* end)
+          : m_lexer(begin, end)
+        {}
+
+        // Start parsing at 'position', the input before it is only used to
+        // report line numbers.
+        Parser(const char* begin, const char* position, const char* end)
+          : m_lexer(begin, position, end)
+        {}
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Interface
+
+        // Parse an '#include "file"' directive.  Returns false if the next
+        // item is not an include.  Includes are only allowed before any
+        // other item.
+        bool include(std::string& file)
+        {
+          if(not m_lexer.acceptWord("#include"))
+            return false;
+          m_lexer.rawString(file);
+          return true;
+        }
+
+        // The position of the parser in the input.
+        const char* position() { m_lexer.skip(); return m_lexer.position(); }
+
+        // Parse all of the input into the configuration, items are merged
+        // with any items already in the configuration.
+        void parse(ConfigType& config)
+        {
+          TreeBuilder builder(config);
+          parse(builder);
+        }
+
+        // Parse all of the input, reporting each item to the handler in the
+        // order it appears.  A section that appears more than once is
+        // reported each time.
+        template<typename Handler>
+        void parse(Handler& handler)
+        {
+          while(not m_lexer.atEnd())
+            prv_parseItem(handler);
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Private Member Functions
+
+        // item := section | key_value_pair | include_section
+        template<typename Handler>
+        void prv_parseItem(Handler& handler)
+        {
+          if(m_lexer.peek() == '#') {
+            prv_parseIncludeSection(handler);
+            return;
+          }
+
+          m_lexer.key(m_key);
+          if(m_lexer.accept(':')) {
+            m_lexer.expect('{');
+            if(not handler.beginSection(m_key))
+              prv_notSection(m_key);
+            while(not m_lexer.accept('}')) {
+              if(m_lexer.atEnd())
+                m_lexer.error("'}'");
+              prv_parseItem(handler);
+            }
+            m_lexer.expect(';');
+            handler.endSection();
+          }
+          else if(m_lexer.accept('=')) {
+            prv_parseValue(m_value);
+            m_lexer.expect(';');
+            handler.value(m_key, m_value);
+          }
+          else {
+            m_lexer.error("'=' or ':'");
+          }
+        }
+
+        // value := string | number | list | bool
+        void prv_parseValue(ConfigTree& value)
+        {
+          Number number;
+          switch(m_lexer.peek())
+          {
+            case '"':
+              value = std::string();
+              m_lexer.quotedString(boost::get<std::string>(value));
+              return;
+            case '(':
+              prv_parseList(value);
+              return;
+          }
+          if(m_lexer.number(number))
+            number.store(value);
+          else if(m_lexer.acceptWord("true"))
+            value = true;
+          else if(m_lexer.acceptWord("false"))
+            value = false;
+          else
+            m_lexer.error("value");
+        }
+
+        // list := '(' ')' | '(' string (',' string)* ')'
+        //                 | '(' number (',' number)* ')'
+        // A list of numbers is a list of doubles, or of boost::int64_ts if
+        // it holds 64 bit integers and nothing else, see NumberList.
+        void prv_parseList(ConfigTree& value)
+        {
+          m_lexer.expect('(');
+          if(m_lexer.accept(')')) {
+            value = std::vector<boost::none_t>();
+          }
+          else if(m_lexer.peek() == '"') {
+            value = std::vector<std::string>();
+            std::vector<std::string>& list =
+              boost::get<std::vector<std::string> >(value);
+            do {
+              list.push_back(std::string());
+              m_lexer.quotedString(list.back());
+            } while(m_lexer.accept(','));
+            m_lexer.expect(')');
+          }
+          else {
+            Number number;
+            do {
+              if(not m_lexer.number(number))
+                m_lexer.error("number");
+              m_numbers.add(number);
+            } while(m_lexer.accept(','));
+            m_lexer.expect(')');
+            m_numbers.store(value);
+          }
+        }
+
+        // include_section := '#include_section' string 'as' string
+        // The include section is stored in the '$references' section as
+        // alias = "address".
+        template<typename Handler>
+        void prv_parseIncludeSection(Handler& handler)
+        {
+          if(not m_lexer.acceptWord("#include_section"))
+            m_lexer.error("'#include_section'");
+          std::string address;
+          m_lexer.quotedString(address);
+          if(not m_lexer.acceptWord("as"))
+            m_lexer.error("'as'");
+          m_lexer.quotedString(m_key);
+
+          if(not handler.includeSection(address, m_key))
+            prv_notSection("$references");
+        }
+
+        void prv_notSection(const ConfigKey& key)
+        {
+          m_lexer.error(boost::str(boost::format(
+                  "'%1%' to be a section") % key));
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Members
+
+        Lexer m_lexer;
+        std::string m_key;
+        ConfigTree m_value;
+        NumberList m_numbers;
+    };
+
+  } // namespace parse
+} // namespace libconfig
+
+#endif // _libconfig_parser_included_
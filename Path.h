@@ -0,0 +1,58 @@
+#ifndef _libconfig_path_included_
+#define _libconfig_path_included_
+
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+
+namespace libconfig {
+
+  // ==========================================================================
+  // A configuration address such as "Section.SubSection.key" split into its
+  // keys once, so that it can be used for any number of lookups without
+  // splitting the address or allocating again.
+  class ConfigPath
+  {
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Types
+
+      typedef std::vector<std::string>::const_iterator const_iterator;
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Construction
+
+      explicit ConfigPath(const std::string& address)
+        : m_address(address)
+      {
+        boost::split(m_keys, address, boost::is_any_of("."));
+      }
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Interface
+
+      // The address the path was compiled from.
+      const std::string& address() const { return m_address; }
+
+      // The keys of the address in order.
+      const std::vector<std::string>& keys() const { return m_keys; }
+
+      const_iterator begin() const { return m_keys.begin(); }
+      const_iterator end() const { return m_keys.end(); }
+      std::size_t size() const { return m_keys.size(); }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Members
+
+      std::string m_address;
+      std::vector<std::string> m_keys;
+  };
+
+} // namespace libconfig
+
+#endif // _libconfig_path_included_
@@ -5,6 +5,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <boost/optional/optional_io.hpp>
 #include <boost/algorithm/string/join.hpp>
 
 namespace libconfig {
@@ -38,6 +39,15 @@ namespace libconfig {
       return oss.str();
     }
 
+    // Specialization of valueToString to print 64 bit integers with the L
+    // suffix they are read with
+    std::string valueToString(boost::int64_t const& i)
+    {
+      std::ostringstream oss;
+      oss << i << 'L';
+      return oss.str();
+    }
+
     // Specialization of valueToString to print string values
     std::string valueToString(std::string const& t)
     {
@@ -0,0 +1,216 @@
+#ifndef _libconfig_query_included_
+#define _libconfig_query_included_
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
+
+namespace libconfig {
+
+  // ==========================================================================
+  // Match an address against a glob pattern, where '*' matches any number
+  // of characters, dots included, and '?' matches any one character.
+  inline bool globMatch(const char* pattern, const char* patternEnd,
+                        const char* text, const char* textEnd)
+  {
+    // Where the last '*' was, to go back to with one more character
+    // matched by it when the rest of the pattern does not match.
+    const char* star = NULL;
+    const char* resume = NULL;
+    while(text != textEnd)
+    {
+      if(pattern != patternEnd and *pattern == '*') {
+        star = ++pattern;
+        resume = text;
+      }
+      else if(pattern != patternEnd and
+              (*pattern == '?' or *pattern == *text)) {
+        ++pattern;
+        ++text;
+      }
+      else if(star != NULL) {
+        pattern = star;
+        text = ++resume;
+      }
+      else {
+        return false;
+      }
+    }
+    while(pattern != patternEnd and *pattern == '*')
+      ++pattern;
+    return pattern == patternEnd;
+  }
+
+  inline bool globMatch(const std::string& pattern, const std::string& text)
+  {
+    return globMatch(pattern.data(), pattern.data() + pattern.size(),
+                     text.data(), text.data() + text.size());
+  }
+
+  // ==========================================================================
+  // The full address of every section and value of a configuration, sorted,
+  // for enumerating the items under a section and matching glob patterns.
+  // The addresses under a prefix are a range of the sorted addresses, found
+  // by binary search.  A pattern is matched against the range of its
+  // characters before the first wildcard or, if its last key has no
+  // wildcards and fewer items have that key, against the items with that
+  // key, so "*.timeout" does not scan the whole configuration.
+  //
+  // The '$references' sections are left out.  The items reached through
+  // '#include_section' aliases are found at the address they are declared
+  // at, not at the addresses of the aliases.
+  //
+  // The index is only read once it is built, by any number of threads.
+  class PathIndex
+  {
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Construction
+
+      // Index the items of a tree, through its read access: TreeAccess,
+      // CompactTree or LazyTree.  A LazyTree is parsed in full.
+      template<typename Tree>
+      explicit PathIndex(const Tree& tree)
+      {
+        prv_collect(tree, tree.root(), std::string());
+        std::sort(m_addresses.begin(), m_addresses.end());
+        for(std::size_t i = 0; i != m_addresses.size(); ++i)
+        {
+          const std::string& address = m_addresses[i];
+          std::string::size_type dot = address.rfind('.');
+          m_lastKeys[dot == std::string::npos ? address
+                                              : address.substr(dot + 1)]
+            .push_back(i);
+        }
+      }
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Interface
+
+      // Append the addresses of the items in a section and in the sections
+      // in it, in order.  An empty prefix is the whole configuration.
+      void enumerate(const std::string& prefix,
+                     std::vector<std::string>& addresses) const
+      {
+        if(prefix.empty()) {
+          addresses.insert(addresses.end(), m_addresses.begin(),
+                           m_addresses.end());
+          return;
+        }
+        Range range = prv_range(prefix + '.');
+        addresses.insert(addresses.end(), range.first, range.second);
+      }
+
+      // Append the addresses that match a glob pattern, in order.
+      void query(const std::string& pattern,
+                 std::vector<std::string>& addresses) const
+      {
+        std::string::size_type wildcard = pattern.find_first_of("*?");
+        if(wildcard == std::string::npos) {
+          Range range = prv_range(pattern);
+          if(range.first != range.second and *range.first == pattern)
+            addresses.push_back(pattern);
+          return;
+        }
+
+        std::string literal(pattern, 0, wildcard);
+        Range range = prv_range(literal);
+        const std::vector<boost::uint32_t>* candidates = NULL;
+        std::string::size_type dot = pattern.rfind('.');
+        if(dot != std::string::npos and
+           pattern.find_first_of("*?", dot) == std::string::npos)
+        {
+          LastKeys::const_iterator it =
+            m_lastKeys.find(pattern.substr(dot + 1));
+          if(it == m_lastKeys.end())
+            return;
+          if(it->second.size() < std::size_t(range.second - range.first))
+            candidates = &it->second;
+        }
+
+        if(candidates == NULL) {
+          for(Iterator it = range.first; it != range.second; ++it)
+            if(globMatch(pattern, *it))
+              addresses.push_back(*it);
+          return;
+        }
+        for(std::size_t i = 0; i != candidates->size(); ++i)
+        {
+          const std::string& address = m_addresses[(*candidates)[i]];
+          if(address.compare(0, literal.size(), literal) == 0 and
+             globMatch(pattern, address))
+            addresses.push_back(address);
+        }
+      }
+
+      std::size_t size() const { return m_addresses.size(); }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Types
+
+      typedef std::vector<std::string>::const_iterator Iterator;
+      typedef std::pair<Iterator, Iterator> Range;
+
+      // True if the prefix is before the address and does not start it.
+      // The addresses that start with a prefix are followed by those that
+      // are after it.
+      struct PrefixBefore
+      {
+        bool operator()(const std::string& prefix,
+                        const std::string& address) const
+        {
+          return address.compare(0, prefix.size(), prefix) > 0;
+        }
+      };
+
+      // The indexes of the addresses, in order, by their last key.
+      typedef boost::unordered_map<std::string,
+                                   std::vector<boost::uint32_t> > LastKeys;
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Member Functions
+
+      template<typename Tree>
+      void prv_collect(const Tree& tree, typename Tree::section_type section,
+                       const std::string& prefix)
+      {
+        std::vector<std::pair<std::string, typename Tree::item_type> > items;
+        tree.items(section, items);
+        for(std::size_t i = 0; i != items.size(); ++i)
+        {
+          if(items[i].first == "$references")
+            continue;
+          std::string address = prefix + items[i].first;
+          typename Tree::section_type child;
+          if(tree.section(items[i].second, child))
+            prv_collect(tree, child, address + '.');
+          m_addresses.push_back(address);
+        }
+      }
+
+      // The addresses that start with the prefix.
+      Range prv_range(const std::string& prefix) const
+      {
+        Iterator first = std::lower_bound(m_addresses.begin(),
+                                          m_addresses.end(), prefix);
+        return Range(first, std::upper_bound(first, m_addresses.end(),
+                                             prefix, PrefixBefore()));
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Members
+
+      std::vector<std::string> m_addresses;
+      LastKeys m_lastKeys;
+  };
+
+} // namespace libconfig
+
+#endif // _libconfig_query_included_
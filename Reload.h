@@ -0,0 +1,194 @@
+#ifndef _libconfig_reload_included_
+#define _libconfig_reload_included_
+
+#include "Configuration.h"
+
+#include <boost/bind/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+namespace libconfig {
+
+  // ==========================================================================
+  // A configuration that can be reloaded while other threads read it.
+  //
+  // Readers take the current configuration with get(), an immutable
+  // Configuration they can read for as long as they hold it without any
+  // locking.  A reload builds a new Configuration on the side and then
+  // publishes it with an atomic store, so readers are never blocked by the
+  // parse and see either the old or the new configuration, never a mix.  A
+  // configuration is freed when the last reader holding it lets it go.
+  class ReloadableConfiguration : boost::noncopyable
+  {
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Types
+
+      typedef boost::shared_ptr<const Configuration> pointer;
+
+      // Builds a new configuration for each reload.
+      typedef boost::function<pointer ()> Loader;
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Construction
+
+      // Load the configuration file, and reload it from the file.
+      ReloadableConfiguration(const std::string& configFilename,
+                              parse::ParseOptions const& options =
+                                parse::ParseOptions())
+        : m_loader(boost::bind(&ReloadableConfiguration::prv_loadFile,
+                               configFilename, options))
+      {
+        m_current = m_loader();
+      }
+
+      // A file name given as a literal would otherwise be as good a match
+      // for the Loader, which boost::function accepts anything for.
+      ReloadableConfiguration(const char* configFilename,
+                              parse::ParseOptions const& options =
+                                parse::ParseOptions())
+        : m_loader(boost::bind(&ReloadableConfiguration::prv_loadFile,
+                               std::string(configFilename), options))
+      {
+        m_current = m_loader();
+      }
+
+      // Load the configuration with the loader, for example to compact it or
+      // to load it from a snapshot.
+      explicit ReloadableConfiguration(Loader const& loader)
+        : m_loader(loader)
+      {
+        m_current = m_loader();
+      }
+
+      ~ReloadableConfiguration()
+      {
+        boost::lock_guard<boost::mutex> lock(m_threadMutex);
+        if(m_thread.joinable())
+          m_thread.join();
+      }
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Interface
+
+      // The current configuration.
+      pointer get() const
+      {
+        return boost::atomic_load(&m_current);
+      }
+
+      // Lookup a value in the current configuration.  Use get() to look up
+      // several values in the same version of the configuration, and to
+      // look up views, which are only valid while the version is held.
+      template<typename T>
+      bool lookupValue(const std::string& address, T& value) const
+      {
+        return get()->lookupValue(address, value);
+      }
+
+      template<typename T>
+      bool lookupValue(const ConfigPath& path, T& value) const
+      {
+        return get()->lookupValue(path, value);
+      }
+
+      template<typename T>
+      LookupStatus tryLookupValue(const std::string& address, T& value) const
+      {
+        return get()->tryLookupValue(address, value);
+      }
+
+      template<typename T>
+      LookupStatus tryLookupValue(const ConfigPath& path, T& value) const
+      {
+        return get()->tryLookupValue(path, value);
+      }
+
+      // Load the configuration again and publish it.  If loading fails the
+      // current configuration is kept and the error is thrown.
+      void reload()
+      {
+        boost::lock_guard<boost::mutex> lock(m_reloadMutex);
+        pointer configuration = m_loader();
+        boost::atomic_store(&m_current, configuration);
+      }
+
+      // Publish a configuration built elsewhere.
+      void publish(pointer const& configuration)
+      {
+        boost::lock_guard<boost::mutex> lock(m_reloadMutex);
+        boost::atomic_store(&m_current, configuration);
+      }
+
+      // Reload on a background thread, waiting for any earlier background
+      // reload first.  An error is kept for lastError() instead of being
+      // thrown.
+      void reloadInBackground()
+      {
+        boost::lock_guard<boost::mutex> lock(m_threadMutex);
+        if(m_thread.joinable())
+          m_thread.join();
+        m_thread = boost::thread(
+            boost::bind(&ReloadableConfiguration::prv_backgroundReload, this));
+      }
+
+      // Wait for a background reload to finish.
+      void wait()
+      {
+        boost::lock_guard<boost::mutex> lock(m_threadMutex);
+        if(m_thread.joinable())
+          m_thread.join();
+      }
+
+      // The error of the last background reload, empty if it succeeded.
+      std::string lastError() const
+      {
+        boost::lock_guard<boost::mutex> lock(m_errorMutex);
+        return m_error;
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Member Functions
+
+      static pointer prv_loadFile(const std::string& configFilename,
+                                  parse::ParseOptions const& options)
+      {
+        return pointer(new Configuration(configFilename, options));
+      }
+
+      void prv_backgroundReload()
+      {
+        std::string error;
+        try {
+          reload();
+        }
+        catch(std::exception const& e) {
+          error = e.what();
+        }
+        boost::lock_guard<boost::mutex> lock(m_errorMutex);
+        m_error = error;
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Members
+
+      Loader m_loader;
+      pointer m_current;
+      boost::mutex m_reloadMutex;
+      boost::mutex m_threadMutex;
+      mutable boost::mutex m_errorMutex;
+      std::string m_error;
+      boost::thread m_thread;
+  };
+
+} // namespace libconfig
+
+#endif // _libconfig_reload_included_
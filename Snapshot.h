@@ -0,0 +1,245 @@
+#ifndef _libconfig_snapshot_included_
+#define _libconfig_snapshot_included_
+
+#include "Compact.h"
+#include "Source.h"
+#include "Include.h"
+#include "Cache.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+#include <boost/cstdint.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/filesystem.hpp>
+
+namespace libconfig {
+
+  // ==========================================================================
+  // Snapshots are CompactTree images written to a file, so that a process
+  // can map a configuration instead of parsing it.  A snapshot file is:
+  //
+  //   SnapshotHeader
+  //   the sources table: for each file the configuration was compiled from,
+  //     its path, size and modification time, then for each environment
+  //     variable its references were resolved with, its name and value
+  //   the CompactTree image, aligned to 8 bytes
+  //
+  // The header holds a checksum of the sources table and of the image.  A
+  // snapshot is only used while every one of its sources is unchanged and
+  // every one of its environment variables has the same value.
+
+  // The files a snapshot was compiled from, the configuration file first.
+  typedef std::vector<parse::FragmentKey> SnapshotSources;
+
+  // The environment variables the references of a snapshot were resolved
+  // with, and their values.
+  typedef std::map<std::string, std::string> SnapshotEnvironment;
+
+  struct SnapshotHeader
+  {
+    char magic[8];
+    boost::uint32_t version;
+    boost::uint32_t sourceCount;
+    boost::uint32_t environmentCount;
+    boost::uint32_t reserved;
+    boost::uint64_t sourcesOffset;
+    boost::uint64_t sourcesSize;
+    boost::uint64_t sourcesChecksum;
+    boost::uint64_t imageOffset;
+    boost::uint64_t imageSize;
+    boost::uint64_t imageChecksum;
+  };
+
+  static const char snapshotMagic[8] = 
+    { 'L', 'C', 'F', 'G', 'S', 'N', 'A', 'P' };
+  static const boost::uint32_t snapshotVersion = 3;
+
+  // A checksum for detecting damaged snapshots, computed a word at a time.
+  inline boost::uint64_t snapshotChecksum(const char* data, std::size_t size)
+  {
+    boost::uint64_t checksum = 14695981039346656037ull, word;
+    std::size_t i = 0;
+    for(; i + 8 <= size; i += 8) {
+      std::memcpy(&word, data + i, 8);
+      checksum = (checksum ^ word) * 1099511628211ull;
+      checksum ^= checksum >> 29;
+    }
+    word = 0;
+    std::memcpy(&word, data + i, size - i);
+    checksum = (checksum ^ word ^ size) * 1099511628211ull;
+    return checksum ^ (checksum >> 29);
+  }
+
+  // The configuration file and every file it includes, as they are now.
+  inline SnapshotSources snapshotSources(const std::string& configFilename)
+  {
+    parse::SourceChain chain(configFilename);
+    SnapshotSources sources;
+    sources.push_back(parse::FragmentKey(chain.root().path()));
+    BOOST_FOREACH(const parse::SourceNode* node, chain.nodes()) {
+      if(node != &chain.root())
+        sources.push_back(parse::FragmentKey(node->path()));
+    }
+    return sources;
+  }
+
+  // Write the compact tree to a snapshot file.  The file is written next to
+  // the snapshot and renamed over it, so readers never see a partial file.
+  inline void writeSnapshot(const std::string& filename,
+                            const CompactTree& tree,
+                            const SnapshotSources& sources,
+                            const SnapshotEnvironment& environment =
+                              SnapshotEnvironment())
+  {
+    std::string table;
+    BOOST_FOREACH(parse::FragmentKey const& source, sources) {
+      boost::int64_t fields[4] = { static_cast<boost::int64_t>(
+                                     source.path.size()),
+                                   source.size, source.seconds,
+                                   source.nanoseconds };
+      table.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+      table.append(source.path);
+      table.resize((table.size() + 7) & ~std::size_t(7));
+    }
+    BOOST_FOREACH(SnapshotEnvironment::value_type const& variable,
+                  environment) {
+      boost::int64_t fields[2] = { static_cast<boost::int64_t>(
+                                     variable.first.size()),
+                                   static_cast<boost::int64_t>(
+                                     variable.second.size()) };
+      table.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+      table.append(variable.first);
+      table.append(variable.second);
+      table.resize((table.size() + 7) & ~std::size_t(7));
+    }
+
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, snapshotMagic, sizeof(header.magic));
+    header.version = snapshotVersion;
+    header.sourceCount = sources.size();
+    header.environmentCount = environment.size();
+    header.sourcesOffset = sizeof(header);
+    header.sourcesSize = table.size();
+    header.sourcesChecksum = snapshotChecksum(table.data(), table.size());
+    header.imageOffset = header.sourcesOffset + header.sourcesSize;
+    header.imageSize = tree.size();
+    header.imageChecksum = snapshotChecksum(tree.data(), tree.size());
+
+    std::string temporary = filename + ".tmp";
+    {
+      std::ofstream file(temporary.c_str(),
+                         std::ios::binary | std::ios::trunc);
+      file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      file.write(table.data(), table.size());
+      file.write(tree.data(), tree.size());
+      if(not file)
+        throw std::runtime_error("Could not write snapshot file: " +
+                                 temporary);
+    }
+    if(std::rename(temporary.c_str(), filename.c_str()) != 0)
+      throw std::runtime_error("Could not write snapshot file: " + filename);
+  }
+
+  // Map a snapshot of the configuration file.  Returns nothing if the
+  // snapshot is missing, damaged, of another version, was compiled from
+  // another file, if any of the files it was compiled from has changed or
+  // if any environment variable its references were resolved with has
+  // changed.  Those environment variables are also returned in the
+  // environment, if one is given.
+  // The image is checked in one pass for anything that would be read out of
+  // bounds, so a damaged snapshot is refused, but its checksum is only
+  // compared when verify is set, which also reads every byte of it.
+  inline boost::optional<CompactTree>
+  readSnapshot(const std::string& filename, const std::string& configFilename,
+               bool verify = false, SnapshotEnvironment* environment = NULL)
+  {
+    try {
+      boost::shared_ptr<parse::SourceBuffer> source(
+          new parse::SourceBuffer(filename));
+      const char* data = source->begin();
+      std::size_t size = source->size();
+
+      SnapshotHeader header;
+      if(size < sizeof(header))
+        return boost::none;
+      std::memcpy(&header, data, sizeof(header));
+      if(std::memcmp(header.magic, snapshotMagic, sizeof(header.magic)) != 0
+         or header.version != snapshotVersion
+         or header.sourceCount == 0
+         or header.sourcesOffset != sizeof(header)
+         or header.sourcesSize > size
+         or header.imageOffset != header.sourcesOffset + header.sourcesSize
+         or header.imageOffset > size
+         or header.imageSize != size - header.imageOffset)
+        return boost::none;
+
+      const char* table = data + header.sourcesOffset;
+      if(snapshotChecksum(table, header.sourcesSize) != header.sourcesChecksum)
+        return boost::none;
+      if(verify and snapshotChecksum(data + header.imageOffset,
+                                     header.imageSize) != header.imageChecksum)
+        return boost::none;
+
+      std::string root = boost::filesystem::canonical(configFilename).string();
+      std::size_t offset = 0;
+      for(std::size_t i = 0; i != header.sourceCount; ++i)
+      {
+        boost::int64_t fields[4];
+        if(offset + sizeof(fields) > header.sourcesSize)
+          return boost::none;
+        std::memcpy(fields, table + offset, sizeof(fields));
+        offset += sizeof(fields);
+        if(fields[0] < 0 or offset + fields[0] > header.sourcesSize)
+          return boost::none;
+        std::string path(table + offset, fields[0]);
+        offset = (offset + fields[0] + 7) & ~std::size_t(7);
+
+        if(i == 0 and path != root)
+          return boost::none;
+        parse::FragmentKey key(path);
+        if(key.size != fields[1] or key.seconds != fields[2] or
+           key.nanoseconds != fields[3])
+          return boost::none;
+      }
+
+      SnapshotEnvironment variables;
+      for(std::size_t i = 0; i != header.environmentCount; ++i)
+      {
+        boost::int64_t fields[2];
+        if(offset + sizeof(fields) > header.sourcesSize)
+          return boost::none;
+        std::memcpy(fields, table + offset, sizeof(fields));
+        offset += sizeof(fields);
+        if(fields[0] < 0 or fields[1] < 0 or
+           fields[0] > boost::int64_t(header.sourcesSize) or
+           offset + fields[0] + fields[1] > header.sourcesSize)
+          return boost::none;
+        std::string name(table + offset, fields[0]);
+        std::string value(table + offset + fields[0], fields[1]);
+        offset = (offset + fields[0] + fields[1] + 7) & ~std::size_t(7);
+
+        const char* current = std::getenv(name.c_str());
+        if(current == NULL or value != current)
+          return boost::none;
+        variables[name].swap(value);
+      }
+
+      CompactTree tree(source, data + header.imageOffset, header.imageSize);
+      if(environment != NULL)
+        environment->swap(variables);
+      return tree;
+    }
+    catch(std::runtime_error const&) {
+      return boost::none;
+    }
+  }
+
+} // namespace libconfig
+
+#endif // _libconfig_snapshot_included_
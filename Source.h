@@ -0,0 +1,131 @@
+#ifndef _libconfig_source_included_
+#define _libconfig_source_included_
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <boost/noncopyable.hpp>
+
+namespace libconfig {
+  namespace parse {
+
+    // ========================================================================
+    // The contents of a configuration file.  Regular files are memory mapped
+    // and parsed in place, pipes and other special files are read into a
+    // buffer.  A mapped file shows any change made to the file in place
+    // afterwards, so a reader that keeps the file past loading it copies it
+    // in to a buffer instead.
+    class SourceBuffer : boost::noncopyable
+    {
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Types
+
+        enum Mode
+        {
+          Map,
+          Copy
+        };
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Construction
+
+        explicit SourceBuffer(const std::string& filename, Mode mode = Map)
+          : m_data(NULL)
+          , m_size(0)
+          , m_mapped(false)
+        {
+          int fd = ::open(filename.c_str(), O_RDONLY);
+          if(fd < 0)
+            throw std::runtime_error("Could not open input file: " + filename);
+
+          struct stat status;
+          bool regular = ::fstat(fd, &status) == 0 and S_ISREG(status.st_mode);
+          if(mode == Map and regular and status.st_size > 0)
+          {
+            void* data = ::mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE,
+                                fd, 0);
+            if(data != MAP_FAILED) {
+              ::madvise(data, status.st_size, MADV_SEQUENTIAL);
+              m_data = static_cast<const char*>(data);
+              m_size = status.st_size;
+              m_mapped = true;
+            }
+          }
+
+          if(not m_mapped and
+             not prv_read(fd, regular ? status.st_size : 0)) {
+            ::close(fd);
+            throw std::runtime_error("Could not read input file: " + filename);
+          }
+          ::close(fd);
+        }
+
+        ~SourceBuffer()
+        {
+          if(m_mapped)
+            ::munmap(const_cast<char*>(m_data), m_size);
+        }
+
+      public:
+        // :: -----------------------------------------------------------------
+        // :: Public Interface
+
+        const char* begin() const { return m_data; }
+        const char* end() const { return m_data + m_size; }
+        std::size_t size() const { return m_size; }
+
+        // Returns true if the file is memory mapped rather than buffered.
+        bool mapped() const { return m_mapped; }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Private Member Functions
+
+        // Read the whole file into the buffer, used for anything that can not
+        // be mapped.  The buffer starts one byte larger than the expected
+        // size, if known, so that a file of that size is read in one pass.
+        bool prv_read(int fd, std::size_t expected)
+        {
+          std::size_t size = 0;
+          m_buffer.resize(expected > 0 ? expected + 1 : 64 * 1024);
+          for(;;)
+          {
+            if(size == m_buffer.size())
+              m_buffer.resize(m_buffer.size() * 2);
+            ssize_t count = ::read(fd, &m_buffer[size], m_buffer.size() - size);
+            if(count < 0 and errno == EINTR)
+              continue;
+            if(count < 0)
+              return false;
+            if(count == 0)
+              break;
+            size += count;
+          }
+          m_data = &m_buffer[0];
+          m_size = size;
+          return true;
+        }
+
+      private:
+        // :: -----------------------------------------------------------------
+        // :: Members
+
+        const char* m_data;
+        std::size_t m_size;
+        bool m_mapped;
+        std::vector<char> m_buffer;
+    };
+
+  } // namespace parse
+} // namespace libconfig
+
+#endif // _libconfig_source_included_
@@ -0,0 +1,316 @@
+#ifndef _libconfig_statistics_included_
+#define _libconfig_statistics_included_
+
+#include "Types.h"
+#include "View.h"
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/foreach.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_set.hpp>
+
+// Statistics are only collected when LIBCONFIG_ENABLE_STATISTICS is defined
+// before the library is included.  Otherwise the timing and counting compile
+// to nothing and Configuration::statistics() reports zeros.
+#ifdef LIBCONFIG_ENABLE_STATISTICS
+#  define LIBCONFIG_STATISTICS(...) __VA_ARGS__
+#else
+#  define LIBCONFIG_STATISTICS(...)
+#endif
+
+namespace libconfig {
+
+  // ==========================================================================
+  // A file of a configuration, its size and the time taken to parse it and
+  // merge it in to the configuration.
+  struct FileStatistics
+  {
+    FileStatistics(const std::string& path, std::size_t bytes, double seconds)
+      : path(path)
+      , bytes(bytes)
+      , parseSeconds(seconds)
+    {}
+
+    std::string path;
+    std::size_t bytes;
+    double parseSeconds;
+  };
+
+  // ==========================================================================
+  // What loading a configuration cost, what it holds and how it has been
+  // looked up in.  See Configuration::statistics.
+  struct Statistics
+  {
+    Statistics()
+      : enabled(false)
+      , loadSeconds(0)
+      , includeSeconds(0)
+      , parseSeconds(0)
+      , mergeSeconds(0)
+      , indexSeconds(0)
+      , resolveSeconds(0)
+      , sections(0)
+      , values(0)
+      , keys(0)
+      , strings(0)
+      , stringBytes(0)
+      , listItems(0)
+      , memoryBytes(0)
+      , lookups(0)
+      , hits(0)
+      , misses(0)
+      , aliasIndirections(0)
+      , referenceResolutions(0)
+      , typeMismatches(0)
+    {}
+
+    // False if the library was compiled without statistics.
+    bool enabled;
+
+    // The phases of loading, in seconds.  Include expansion is opening the
+    // files and finding their includes.  Parsing a file includes merging it
+    // in to the configuration, unless the files are all parsed first, with
+    // several threads or through the fragment cache, and then merged.
+    double loadSeconds;
+    double includeSeconds;
+    double parseSeconds;
+    double mergeSeconds;
+    double indexSeconds;
+    double resolveSeconds;
+
+    // The files in the order they were parsed.
+    std::vector<FileStatistics> files;
+
+    // The contents of the configuration.  The keys are the distinct keys,
+    // the strings are the string values and the items of string lists.  A
+    // lazy configuration is not counted, that would parse all of it.
+    std::size_t sections;
+    std::size_t values;
+    std::size_t keys;
+    std::size_t strings;
+    std::size_t stringBytes;
+    std::size_t listItems;
+    std::size_t memoryBytes;
+
+    // The lookups made through lookupValue.  Aliases are the
+    // '#include_section' aliases followed, references the '${}' references
+    // resolved while looking up strings, mismatches the lookups that found
+    // an item of another type.
+    unsigned long lookups;
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long aliasIndirections;
+    unsigned long referenceResolutions;
+    unsigned long typeMismatches;
+
+    // The statistics as a JSON object.
+    std::string json() const
+    {
+      std::string out;
+      out += "{\"enabled\": ";
+      out += enabled ? "true" : "false";
+      out += ", \"load\": {";
+      prv_field(out, "seconds", loadSeconds, true);
+      prv_field(out, "include_seconds", includeSeconds);
+      prv_field(out, "parse_seconds", parseSeconds);
+      prv_field(out, "merge_seconds", mergeSeconds);
+      prv_field(out, "index_seconds", indexSeconds);
+      prv_field(out, "resolve_seconds", resolveSeconds);
+      out += ", \"files\": [";
+      for(std::size_t i = 0; i != files.size(); ++i) {
+        out += i == 0 ? "{\"path\": " : ", {\"path\": ";
+        prv_string(out, files[i].path);
+        prv_count(out, "bytes", files[i].bytes);
+        prv_field(out, "parse_seconds", files[i].parseSeconds);
+        out += '}';
+      }
+      out += "]}, \"tree\": {";
+      prv_count(out, "sections", sections, true);
+      prv_count(out, "values", values);
+      prv_count(out, "keys", keys);
+      prv_count(out, "strings", strings);
+      prv_count(out, "string_bytes", stringBytes);
+      prv_count(out, "list_items", listItems);
+      prv_count(out, "memory_bytes", memoryBytes);
+      out += "}, \"lookups\": {";
+      prv_count(out, "count", lookups, true);
+      prv_count(out, "hits", hits);
+      prv_count(out, "misses", misses);
+      prv_count(out, "alias_indirections", aliasIndirections);
+      prv_count(out, "reference_resolutions", referenceResolutions);
+      prv_count(out, "type_mismatches", typeMismatches);
+      out += "}}";
+      return out;
+    }
+
+    private:
+      static void prv_field(std::string& out, const char* name, double value,
+                            bool first = false)
+      {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        prv_name(out, name, first);
+        out += buffer;
+      }
+
+      static void prv_count(std::string& out, const char* name,
+                            unsigned long value, bool first = false)
+      {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%lu", value);
+        prv_name(out, name, first);
+        out += buffer;
+      }
+
+      static void prv_name(std::string& out, const char* name, bool first)
+      {
+        out += first ? "\"" : ", \"";
+        out += name;
+        out += "\": ";
+      }
+
+      static void prv_string(std::string& out, const std::string& value)
+      {
+        out += '"';
+        BOOST_FOREACH(char c, value) {
+          if(c == '"' or c == '\\') {
+            out += '\\';
+            out += c;
+          }
+          else if(static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            out += buffer;
+          }
+          else {
+            out += c;
+          }
+        }
+        out += '"';
+      }
+  };
+
+  // ==========================================================================
+  // The lookup counters of a Configuration.  Lookups are made concurrently,
+  // so they are counted atomically, without ordering.
+  class LookupCounters : boost::noncopyable
+  {
+    public:
+      LookupCounters()
+        : lookups(0)
+        , hits(0)
+        , misses(0)
+        , aliasIndirections(0)
+        , referenceResolutions(0)
+        , typeMismatches(0)
+      {}
+
+      static void count(boost::atomic<unsigned long>& counter)
+      {
+        counter.fetch_add(1, boost::memory_order_relaxed);
+      }
+
+      void read(Statistics& statistics) const
+      {
+        statistics.lookups = lookups.load(boost::memory_order_relaxed);
+        statistics.hits = hits.load(boost::memory_order_relaxed);
+        statistics.misses = misses.load(boost::memory_order_relaxed);
+        statistics.aliasIndirections =
+          aliasIndirections.load(boost::memory_order_relaxed);
+        statistics.referenceResolutions =
+          referenceResolutions.load(boost::memory_order_relaxed);
+        statistics.typeMismatches =
+          typeMismatches.load(boost::memory_order_relaxed);
+      }
+
+      boost::atomic<unsigned long> lookups;
+      boost::atomic<unsigned long> hits;
+      boost::atomic<unsigned long> misses;
+      boost::atomic<unsigned long> aliasIndirections;
+      boost::atomic<unsigned long> referenceResolutions;
+      boost::atomic<unsigned long> typeMismatches;
+  };
+
+  // ==========================================================================
+  // Measures the time between laps.
+  class Stopwatch
+  {
+    public:
+      Stopwatch()
+        : m_last(prv_now())
+      {}
+
+      // The seconds since the last lap or since the stopwatch was started.
+      double lap()
+      {
+        double now = prv_now();
+        double seconds = now - m_last;
+        m_last = now;
+        return seconds;
+      }
+
+    private:
+      static double prv_now()
+      {
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return now.tv_sec + now.tv_nsec * 1e-9;
+      }
+
+      double m_last;
+  };
+
+  // ==========================================================================
+  // Count the sections and values of a tree through its read access,
+  // TreeAccess or CompactTree.  The values are read as views, so counting
+  // them does not copy them.
+  template<typename Tree>
+  void countTree(const Tree& tree, typename Tree::section_type section,
+                 Statistics& statistics,
+                 boost::unordered_set<std::string>& keys)
+  {
+    std::vector<std::pair<std::string, typename Tree::item_type> > items;
+    tree.items(section, items);
+    boost::string_ref string;
+    ListView<std::string> strings;
+    ListView<double> doubles;
+    ListView<int> ints;
+    ListView<boost::int64_t> int64s;
+    for(std::size_t i = 0; i != items.size(); ++i)
+    {
+      typename Tree::item_type item = items[i].second;
+      typename Tree::section_type child;
+      keys.insert(items[i].first);
+      if(tree.section(item, child)) {
+        ++statistics.sections;
+        countTree(tree, child, statistics, keys);
+        continue;
+      }
+      ++statistics.values;
+      if(tree.get(item, string)) {
+        ++statistics.strings;
+        statistics.stringBytes += string.size();
+      }
+      else if(tree.get(item, strings)) {
+        statistics.listItems += strings.size();
+        statistics.strings += strings.size();
+        BOOST_FOREACH(boost::string_ref s, strings)
+          statistics.stringBytes += s.size();
+      }
+      else if(tree.get(item, doubles))
+        statistics.listItems += doubles.size();
+      else if(tree.get(item, ints))
+        statistics.listItems += ints.size();
+      else if(tree.get(item, int64s))
+        statistics.listItems += int64s.size();
+    }
+  }
+
+} // namespace libconfig
+
+#endif // _libconfig_statistics_included_
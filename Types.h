@@ -7,6 +7,7 @@
 #include <string>
 #include <vector>
 
+#include <boost/cstdint.hpp>
 #include <boost/none.hpp>
 #include <boost/variant/recursive_variant.hpp>
 #include <boost/variant/get.hpp>
@@ -24,10 +25,12 @@ namespace libconfig {
   //   ConfigKey ->  std::string
   //             or   double
   //             or   int
+  //             or   boost::int64_t
   //             or   bool
   //             or   std::vector<std::string>
   //             or   std::vector<double>
   //             or   std::vector<int>
+  //             or   std::vector<boost::int64_t>
   //             or   std::vector<boost::none_t>
   //             or   map<ConfigKey, ConfigTree>
 
@@ -37,10 +40,12 @@ namespace libconfig {
           std::string
         , double
         , int
+        , boost::int64_t
         , bool
         , std::vector<std::string>
         , std::vector<double>
         , std::vector<int>
+        , std::vector<boost::int64_t>
         , std::vector<boost::none_t>
         , map<ConfigKey, boost::recursive_variant_>
       >::type 
@@ -68,74 +73,17 @@ namespace libconfig {
       
       typedef typename base::iterator iterator;
 
-    private:
-      // :: -------------------------------------------------------------------
-      // :: boost::variant visitor functor that inserts a new value into the
-      // :: map.  This will overwrite a value if it already exists or if the
-      // :: thing to insert is a section the section will be either inserted if
-      // :: it is a new section or merged with an existing section.
-       
-      struct map_inserter : boost::static_visitor<>
-      {
-        public:
-          // :: ---------------------------------------------------------------
-          // :: Construction
-
-          map_inserter(map<ConfigKey, ConfigTree> *pointer, 
-                       ConfigKey const& key) 
-            : m_map(pointer) 
-            , m_key(key)
-          {}
-
-        public:
-          // :: ---------------------------------------------------------------
-          // :: Public Interface operator()
-
-          // Insert a section, if the section is not found insert the new
-          // section, if the section is already there merge the new section with
-          // the existing one.
-          void operator()(ConfigType const& t) const
-          {
-            std::map<ConfigKey, ConfigTree>::iterator it = m_map->find(m_key);
-            if(it == m_map->end()) {
-              m_map->insert(std::make_pair(m_key, t));
-            }
-            else {
-              ConfigType& node = boost::get<ConfigType>(it->second);
-              BOOST_FOREACH(ConfigType::value_type value, t) {
-                node.insert(node.begin(), value);
-              }
-            }
-          }
-
-          // Inserting a value, either inset the new value or if the value is
-          // already there, overwrite the existing one.
-          template<typename T> 
-          void operator()(T const& t) const
-          {
-            (*m_map)[m_key] = t;
-          }
-
-        private:
-          // :: ---------------------------------------------------------------
-          // :: Members
-
-          map<ConfigKey, ConfigTree> *m_map;
-          ConfigKey m_key;
-      };
-
     public:
       // :: -------------------------------------------------------------------
       // :: Construction - Provide access to the std::map's constructors
 
+      // The copy constructor and assignment are the implicit ones, so that
+      // the map also has the implicit move constructor and a section moves
+      // in to a ConfigTree without being copied.
       map() 
         : base() 
       { }
 
-      map(const map& other) 
-        : base(other) 
-      { }
-
       template<class InputIt> map(InputIt first, InputIt last) 
         : base(first, last) 
       { }
@@ -144,15 +92,40 @@ namespace libconfig {
       // :: -------------------------------------------------------------------
       // :: Overwrite the Insert functions
 
-      // This is the insert function that boost phoenix uses to insert values
-      // into a map.
+      // Insert a copy of the value, see splice.
       typename base::iterator 
       insert(typename base::iterator hint, 
              const typename base::value_type& value)
       {
-        boost::apply_visitor(map_inserter(this, value.first), value.second);
+        ConfigTree copy(value.second);
+        splice(value.first, copy);
         return hint;
       }
+
+      // Move a value in to the map, leaving 'value' in an unspecified state.
+      // A value replaces the existing item of the key.  A section is inserted
+      // if there is no item of the key, otherwise its items are spliced in to
+      // the existing section one by one, which must be a section.  Nothing
+      // is copied, so merging costs the number of items merged no matter how
+      // deeply they are nested.
+      void splice(const ConfigKey& key, ConfigTree& value)
+      {
+        typename base::iterator it = base::lower_bound(key);
+        if(it == base::end() or it->first != key) {
+          it = base::insert(it, typename base::value_type(key, ConfigTree()));
+          it->second.swap(value);
+          return;
+        }
+        map* section = boost::get<map>(&value);
+        if(section == NULL) {
+          it->second.swap(value);
+          return;
+        }
+        map& existing = boost::get<map>(it->second);
+        for(typename base::iterator item = section->begin();
+            item != section->end(); ++item)
+          existing.splice(item->first, item->second);
+      }
         
       std::pair<typename base::iterator, bool> insert( const typename base::value_type& value ) 
       { return base::insert(value); }
@@ -160,6 +133,91 @@ namespace libconfig {
       { base::insert(first, last); }
   };
 
+  // ==========================================================================
+  // The outcome of a lookup that does not throw, see
+  // Configuration::tryLookupValue.
+  enum LookupStatus
+  {
+    LookupFound,
+    LookupNotFound,         // there is no item at the address
+    LookupNotSection,       // a key before the last names a value
+    LookupTypeMismatch,     // the item is not of the type requested
+    LookupUnresolved        // a string viewed before its references resolved
+  };
+
+  // ==========================================================================
+  // Read a value stored as 'From' in to a variable of the same type or of a
+  // wider type it converts to.  Returns false, leaving the variable
+  // untouched, if the value is of another type.
+  template<typename From, typename To>
+  bool readAs(const ConfigTree& tree, To& value)
+  {
+    const From* t = boost::get<From>(&tree);
+    if(t == NULL)
+      return false;
+    value = *t;
+    return true;
+  }
+
+  template<typename From, typename To>
+  bool readAs(const ConfigTree& tree, std::vector<To>& value)
+  {
+    const std::vector<From>* t = boost::get<std::vector<From> >(&tree);
+    if(t == NULL)
+      return false;
+    value.assign(t->begin(), t->end());
+    return true;
+  }
+
+  // An empty list is read as an empty list of any type.
+  template<typename T>
+  bool readEmpty(const ConfigTree& tree, std::vector<T>& value)
+  {
+    if(boost::get<std::vector<boost::none_t> >(&tree) == NULL)
+      return false;
+    value.clear();
+    return true;
+  }
+
+  // Read a value in to a variable of its type.  Numbers are also read in to
+  // a wider type, an int as a boost::int64_t and either as a double, and so
+  // are lists of numbers.
+  template<typename T>
+  bool readValue(const ConfigTree& tree, T& value)
+  {
+    return readAs<T>(tree, value);
+  }
+
+  template<typename T>
+  bool readValue(const ConfigTree& tree, std::vector<T>& value)
+  {
+    return readEmpty(tree, value) or readAs<T>(tree, value);
+  }
+
+  inline bool readValue(const ConfigTree& tree, boost::int64_t& value)
+  {
+    return readAs<boost::int64_t>(tree, value) or readAs<int>(tree, value);
+  }
+
+  inline bool readValue(const ConfigTree& tree, double& value)
+  {
+    return readAs<double>(tree, value) or readAs<int>(tree, value) or
+           readAs<boost::int64_t>(tree, value);
+  }
+
+  inline bool readValue(const ConfigTree& tree,
+                        std::vector<boost::int64_t>& value)
+  {
+    return readEmpty(tree, value) or readAs<boost::int64_t>(tree, value) or
+           readAs<int>(tree, value);
+  }
+
+  inline bool readValue(const ConfigTree& tree, std::vector<double>& value)
+  {
+    return readEmpty(tree, value) or readAs<double>(tree, value) or
+           readAs<int>(tree, value) or readAs<boost::int64_t>(tree, value);
+  }
+
 
 } // namespace libconfig
 
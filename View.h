@@ -0,0 +1,207 @@
+#ifndef _libconfig_view_included_
+#define _libconfig_view_included_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/utility/string_ref.hpp>
+
+namespace libconfig {
+
+  // ==========================================================================
+  // A read only view of the elements of a list stored in a configuration,
+  // looked up with Configuration::lookupValue in place of a std::vector to
+  // read the list without copying it.  An empty list is an empty view of
+  // any type.  The view refers to the configuration it was looked up in and
+  // is only valid as long as that is neither changed nor destroyed; see
+  // Configuration::lookupValue.
+  template<typename T>
+  class ListView
+  {
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Types
+
+      typedef T value_type;
+      typedef const T* iterator;
+      typedef const T* const_iterator;
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Construction
+
+      ListView()
+        : m_data(NULL)
+        , m_size(0)
+      {}
+
+      ListView(const T* data, std::size_t size)
+        : m_data(data)
+        , m_size(size)
+      {}
+
+      explicit ListView(const std::vector<T>& list)
+        : m_data(list.empty() ? NULL : &list[0])
+        , m_size(list.size())
+      {}
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Interface
+
+      const_iterator begin() const { return m_data; }
+      const_iterator end() const { return m_data + m_size; }
+
+      std::size_t size() const { return m_size; }
+      bool empty() const { return m_size == 0; }
+
+      const T& operator[](std::size_t i) const { return m_data[i]; }
+      const T& front() const { return m_data[0]; }
+      const T& back() const { return m_data[m_size - 1]; }
+      const T* data() const { return m_data; }
+
+      // A copy of the elements.
+      std::vector<T> vector() const
+      {
+        return std::vector<T>(begin(), end());
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Members
+
+      const T* m_data;
+      std::size_t m_size;
+  };
+
+  // ==========================================================================
+  // A view of a list of strings, whose elements are views of the strings.
+  // A CompactTree does not store its strings as std::strings, so the
+  // elements of its lists are read through a function of the tree.
+  template<>
+  class ListView<std::string>
+  {
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Types
+
+      typedef boost::string_ref value_type;
+
+      // Reads element 'i' of the elements of a list, with the pool of
+      // characters they refer to.
+      typedef boost::string_ref (*Reader)(const void* elements,
+                                          const char* pool, std::size_t i);
+
+      class const_iterator
+        : public boost::iterator_facade<const_iterator, boost::string_ref,
+                                        boost::random_access_traversal_tag,
+                                        boost::string_ref>
+      {
+        public:
+          const_iterator()
+            : m_list(NULL)
+            , m_index(0)
+          {}
+
+          const_iterator(const ListView* list, std::size_t index)
+            : m_list(list)
+            , m_index(index)
+          {}
+
+        private:
+          friend class boost::iterator_core_access;
+
+          boost::string_ref dereference() const { return (*m_list)[m_index]; }
+          bool equal(const_iterator const& other) const
+          {
+            return m_index == other.m_index;
+          }
+          void increment() { ++m_index; }
+          void decrement() { --m_index; }
+          void advance(std::ptrdiff_t n) { m_index += n; }
+          std::ptrdiff_t distance_to(const_iterator const& other) const
+          {
+            return std::ptrdiff_t(other.m_index) - std::ptrdiff_t(m_index);
+          }
+
+          const ListView* m_list;
+          std::size_t m_index;
+      };
+
+      typedef const_iterator iterator;
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Construction
+
+      ListView()
+        : m_strings(NULL)
+        , m_elements(NULL)
+        , m_pool(NULL)
+        , m_reader(NULL)
+        , m_size(0)
+      {}
+
+      explicit ListView(const std::vector<std::string>& list)
+        : m_strings(list.empty() ? NULL : &list[0])
+        , m_elements(NULL)
+        , m_pool(NULL)
+        , m_reader(NULL)
+        , m_size(list.size())
+      {}
+
+      ListView(const void* elements, const char* pool, Reader reader,
+               std::size_t size)
+        : m_strings(NULL)
+        , m_elements(elements)
+        , m_pool(pool)
+        , m_reader(reader)
+        , m_size(size)
+      {}
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Interface
+
+      const_iterator begin() const { return const_iterator(this, 0); }
+      const_iterator end() const { return const_iterator(this, m_size); }
+
+      std::size_t size() const { return m_size; }
+      bool empty() const { return m_size == 0; }
+
+      boost::string_ref operator[](std::size_t i) const
+      {
+        if(m_reader != NULL)
+          return m_reader(m_elements, m_pool, i);
+        return boost::string_ref(m_strings[i]);
+      }
+
+      boost::string_ref front() const { return (*this)[0]; }
+      boost::string_ref back() const { return (*this)[m_size - 1]; }
+
+      // A copy of the elements.
+      std::vector<std::string> vector() const
+      {
+        std::vector<std::string> list;
+        list.reserve(m_size);
+        for(std::size_t i = 0; i != m_size; ++i)
+          list.push_back((*this)[i].to_string());
+        return list;
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Members
+
+      const std::string* m_strings;
+      const void* m_elements;
+      const char* m_pool;
+      Reader m_reader;
+      std::size_t m_size;
+  };
+
+} // namespace libconfig
+
+#endif // _libconfig_view_included_
@@ -0,0 +1,634 @@
+#ifndef _libconfig_watch_included_
+#define _libconfig_watch_included_
+
+#include "Configuration.h"
+
+#include <cerrno>
+#include <map>
+#include <set>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+namespace libconfig {
+
+  // ==========================================================================
+  // A configuration that follows its files on disk.  The watcher keeps each
+  // file of the include tree parsed on its own and watches the directories
+  // they are in with inotify.  When files change only those files are parsed
+  // again, and only the items they declare, before or after the change, are
+  // merged again from every file that declares them, in include order and
+  // with the same semantics as parsing the whole configuration.  A change to
+  // the '#include' directives of a file rediscovers the include tree,
+  // parsing only the files that are new or changed.
+  //
+  // Readers take the current configuration with get(), as with a
+  // ReloadableConfiguration.  Each change is published as a new
+  // Configuration; the previous one is updated in place for the next change
+  // once no reader holds it, otherwise it is copied.
+  //
+  // poll() and update() are called from one thread at a time.  Only the
+  // parser of the options is used, each file is parsed once by the watcher.
+  class ConfigurationWatcher : boost::noncopyable
+  {
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Types
+
+      typedef boost::shared_ptr<const Configuration> pointer;
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Construction
+
+      ConfigurationWatcher(const std::string& configFilename,
+                           parse::ParseOptions const& options =
+                             parse::ParseOptions())
+        : m_options(options)
+        , m_root(configFilename)
+        , m_inotify(-1)
+      {
+        if(m_root.root_directory().empty())
+          m_root = boost::filesystem::current_path() / m_root;
+        m_root = m_root.lexically_normal();
+
+        m_inotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(m_inotify < 0)
+          throw std::runtime_error("Could not watch configuration file: " +
+                                   m_root.string());
+        try {
+          prv_discover(m_files, m_order);
+          prv_publish(prv_build(m_files, m_order, m_aliases));
+          prv_watch();
+        }
+        catch(...) {
+          ::close(m_inotify);
+          throw;
+        }
+      }
+
+      ~ConfigurationWatcher()
+      {
+        ::close(m_inotify);
+      }
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Interface
+
+      // The current configuration.
+      pointer get() const
+      {
+        return boost::atomic_load(&m_current);
+      }
+
+      // Lookup a value in the current configuration.  Use get() to look up
+      // several values in the same version of the configuration, and to
+      // look up views, which are only valid while the version is held.
+      template<typename T>
+      bool lookupValue(const std::string& address, T& value) const
+      {
+        return get()->lookupValue(address, value);
+      }
+
+      template<typename T>
+      bool lookupValue(const ConfigPath& path, T& value) const
+      {
+        return get()->lookupValue(path, value);
+      }
+
+      template<typename T>
+      LookupStatus tryLookupValue(const std::string& address, T& value) const
+      {
+        return get()->tryLookupValue(address, value);
+      }
+
+      template<typename T>
+      LookupStatus tryLookupValue(const ConfigPath& path, T& value) const
+      {
+        return get()->tryLookupValue(path, value);
+      }
+
+      // The inotify descriptor, readable when files may have changed, for
+      // waiting on in an event loop before calling poll().
+      int fd() const { return m_inotify; }
+
+      // Wait up to timeout milliseconds, -1 to wait indefinitely, for files
+      // of the configuration to change and publish the changes.  Returns
+      // true if a new configuration was published.  If a changed file can
+      // not be parsed the current configuration is kept and the error is
+      // thrown; the file is parsed again when it next changes.
+      bool poll(int timeout = 0)
+      {
+        pollfd descriptor = { m_inotify, POLLIN, 0 };
+        int ready = ::poll(&descriptor, 1, timeout);
+        if(ready < 0 and errno != EINTR)
+          throw std::runtime_error("Could not watch configuration file: " +
+                                   m_root.string());
+        if(ready <= 0)
+          return false;
+
+        std::set<std::string> changed;
+        char buffer[4096]
+          __attribute__ ((aligned(__alignof__(struct inotify_event))));
+        for(;;)
+        {
+          ssize_t length = ::read(m_inotify, buffer, sizeof(buffer));
+          if(length <= 0)
+            break;
+          for(char* p = buffer; p < buffer + length; )
+          {
+            const inotify_event* event =
+              reinterpret_cast<const inotify_event*>(p);
+            std::map<int, std::string>::const_iterator directory =
+              m_directories.find(event->wd);
+            if(directory != m_directories.end() and event->len > 0)
+              changed.insert((boost::filesystem::path(directory->second) /
+                              event->name).string());
+            p += sizeof(inotify_event) + event->len;
+          }
+        }
+        return prv_update(changed);
+      }
+
+      // Check every file of the configuration for changes, whether or not
+      // inotify reported them, and publish the changes.  Returns true if a
+      // new configuration was published.
+      bool update()
+      {
+        std::set<std::string> changed;
+        BOOST_FOREACH(Files::value_type const& file, m_files)
+          changed.insert(file.first);
+        return prv_update(changed);
+      }
+
+      // The files of the configuration, in the order they are merged.
+      std::vector<std::string> const& files() const { return m_order; }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Types
+
+      // A file of the include tree as it was last parsed.
+      struct File
+      {
+        parse::FragmentKey key;
+        parse::Fragment fragment;
+      };
+
+      typedef std::map<std::string, File> Files;
+
+      // The keys of an item.
+      typedef std::vector<std::string> Keys;
+
+      // How an item of the configuration appears in one file.
+      enum Declaration { Absent, Declared, Replaced };
+
+      // Compares a value to another, sections are compared item by item by
+      // prv_difference rather than here.
+      struct Equal : boost::static_visitor<bool>
+      {
+        explicit Equal(ConfigTree const& other)
+          : other(other)
+        {}
+
+        template<typename T>
+        bool operator()(T const& t) const
+        {
+          const T* value = boost::get<T>(&other);
+          return value != NULL and *value == t;
+        }
+
+        bool operator()(std::vector<boost::none_t> const& t) const
+        {
+          return boost::get<std::vector<boost::none_t> >(&other) != NULL;
+        }
+
+        bool operator()(ConfigType const& t) const
+        {
+          return false;
+        }
+
+        ConfigTree const& other;
+      };
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Member Functions
+
+      // Parse the files that changed and publish the result.
+      bool prv_update(std::set<std::string> const& candidates)
+      {
+        boost::lock_guard<boost::mutex> lock(m_updateMutex);
+
+        Files changed;
+        bool includesChanged = false;
+        BOOST_FOREACH(std::string const& path, candidates)
+        {
+          Files::iterator file = m_files.find(path);
+          if(file == m_files.end())
+            continue;
+          parse::FragmentKey key(path);
+          if(key == file->second.key)
+            continue;
+          File& parsed = changed[path];
+          prv_parse(path, key, parsed);
+          includesChanged = includesChanged or
+            not prv_sameIncludes(parsed.fragment.includes,
+                                 file->second.fragment.includes);
+        }
+        if(changed.empty())
+          return false;
+
+        if(includesChanged) {
+          Files files;
+          std::vector<std::string> order;
+          std::set<Keys> aliases;
+          prv_discover(files, order, &changed);
+          prv_publish(prv_build(files, order, aliases));
+          m_spare.reset();
+          m_stale.clear();
+          m_files.swap(files);
+          m_order.swap(order);
+          m_aliases.swap(aliases);
+          prv_watch();
+          return true;
+        }
+
+        std::vector<Keys> affected;
+        BOOST_FOREACH(Files::value_type& file, changed)
+          prv_difference(m_files[file.first].fragment.configuration,
+                         file.second.fragment.configuration, Keys(),
+                         affected);
+
+        // Swap the new files in, and back out again if merging fails.
+        BOOST_FOREACH(Files::value_type& file, changed)
+          prv_swap(m_files[file.first], file.second);
+        try {
+          boost::shared_ptr<Configuration> configuration;
+          bool merged;
+          if(m_spare and m_spare.unique()) {
+            configuration.swap(m_spare);
+            m_stale.insert(m_stale.end(), affected.begin(), affected.end());
+            merged = prv_merge(*configuration, m_stale);
+          }
+          else {
+            m_spare.reset();
+            configuration.reset(new Configuration(*m_current));
+            merged = prv_merge(*configuration, affected);
+          }
+          std::set<Keys> aliases(m_aliases);
+          if(merged)
+            prv_aliases(configuration->m_configurationMap, affected, aliases);
+          else {
+            aliases.clear();
+            prv_aliases(configuration->m_configurationMap, Keys(), aliases);
+          }
+          prv_buildIndex(*configuration, aliases);
+
+          m_aliases.swap(aliases);
+          m_spare = m_current;
+          m_stale.swap(affected);
+          prv_publish(configuration);
+        }
+        catch(...) {
+          BOOST_FOREACH(Files::value_type& file, changed)
+            prv_swap(m_files[file.first], file.second);
+          throw;
+        }
+        return true;
+      }
+
+      // Walk the include tree from the configuration file, recording the
+      // order the files are merged in.  Files are taken from the changed
+      // files, then from the current files if unchanged, and parsed
+      // otherwise.
+      void prv_discover(Files& files, std::vector<std::string>& order,
+                        Files* changed = NULL)
+      {
+        std::vector<std::string> stack;
+        prv_discover(m_root, files, order, changed, stack);
+      }
+
+      void prv_discover(boost::filesystem::path const& filePath, Files& files,
+                        std::vector<std::string>& order, Files* changed,
+                        std::vector<std::string>& stack)
+      {
+        std::string path = filePath.string();
+        if(std::find(stack.begin(), stack.end(), path) != stack.end())
+          throw std::runtime_error(boost::str(boost::format(
+                  "Parsing Includes Failed: '%1%' includes itself") % path));
+
+        Files::iterator file = files.find(path);
+        if(file == files.end())
+        {
+          file = files.insert(std::make_pair(path, File())).first;
+          Files::iterator current;
+          if(changed and changed->count(path))
+            prv_swap(file->second, (*changed)[path]);
+          else if((current = m_files.find(path)) != m_files.end() and
+                  current->second.key == parse::FragmentKey(path))
+            file->second = current->second;
+          else
+            prv_parse(path, parse::FragmentKey(path), file->second);
+        }
+
+        std::vector<parse::IncludeDirective> includes =
+          file->second.fragment.includes;
+        stack.push_back(path);
+        BOOST_FOREACH(parse::IncludeDirective const& include, includes)
+          prv_discover(include.path, files, order, changed, stack);
+        stack.pop_back();
+
+        order.push_back(path);
+      }
+
+      void prv_parse(const std::string& path, parse::FragmentKey const& key,
+                     File& file)
+      {
+        parse::SourceNode node(path);
+        file.key = key;
+        file.fragment.includes = node.directives();
+        parse::_parseSource(node, m_options, file.fragment.configuration);
+      }
+
+      static bool prv_sameIncludes(
+          std::vector<parse::IncludeDirective> const& first,
+          std::vector<parse::IncludeDirective> const& second)
+      {
+        if(first.size() != second.size())
+          return false;
+        for(std::size_t i = 0; i != first.size(); ++i) {
+          if(first[i].path != second[i].path)
+            return false;
+        }
+        return true;
+      }
+
+      static void prv_swap(File& first, File& second)
+      {
+        std::swap(first.key, second.key);
+        first.fragment.includes.swap(second.fragment.includes);
+        first.fragment.configuration.swap(second.fragment.configuration);
+      }
+
+      // Merge every file in to a new configuration.
+      static boost::shared_ptr<Configuration>
+      prv_build(Files const& files, std::vector<std::string> const& order,
+                std::set<Keys>& aliases)
+      {
+        boost::shared_ptr<Configuration> configuration(new Configuration);
+        BOOST_FOREACH(std::string const& path, order)
+          parse::_mergeFragment(files.find(path)->second.fragment.configuration,
+                                configuration->m_configurationMap);
+        prv_aliases(configuration->m_configurationMap, Keys(), aliases);
+        prv_buildIndex(*configuration, aliases);
+        return configuration;
+      }
+
+      // Append the keys of the items that differ between two versions of a
+      // section.  Sections in both are compared item by item.
+      static void prv_difference(ConfigType const& before,
+                                 ConfigType const& after, Keys const& keys,
+                                 std::vector<Keys>& affected)
+      {
+        ConfigType::const_iterator first = before.begin();
+        ConfigType::const_iterator second = after.begin();
+        while(first != before.end() or second != after.end())
+        {
+          Keys item(keys);
+          if(second == after.end() or
+             (first != before.end() and first->first < second->first)) {
+            item.push_back((first++)->first);
+            affected.push_back(item);
+            continue;
+          }
+          if(first == before.end() or second->first < first->first) {
+            item.push_back((second++)->first);
+            affected.push_back(item);
+            continue;
+          }
+          item.push_back(first->first);
+          const ConfigType* sectionBefore =
+            boost::get<ConfigType>(&first->second);
+          const ConfigType* sectionAfter =
+            boost::get<ConfigType>(&second->second);
+          if(sectionBefore and sectionAfter)
+            prv_difference(*sectionBefore, *sectionAfter, item, affected);
+          else if(not boost::apply_visitor(Equal(second->second),
+                                           first->second))
+            affected.push_back(item);
+          ++first;
+          ++second;
+        }
+      }
+
+      // Merge the items again from every file in to the configuration.  If
+      // an item can not be put in place the whole configuration is merged
+      // again and false is returned.
+      bool prv_merge(Configuration& configuration,
+                     std::vector<Keys> const& affected) const
+      {
+        bool merged = true;
+        BOOST_FOREACH(Keys const& keys, affected) {
+          merged = prv_merge(configuration.m_configurationMap, keys);
+          if(not merged)
+            break;
+        }
+        if(not merged) {
+          ConfigType().swap(configuration.m_configurationMap);
+          BOOST_FOREACH(std::string const& path, m_order)
+            parse::_mergeFragment(
+                m_files.find(path)->second.fragment.configuration,
+                configuration.m_configurationMap);
+        }
+        return merged;
+      }
+
+      // Merge one item from every file that declares it, inserting it the
+      // way the parser does so that sections are merged and values
+      // overwritten.
+      bool prv_merge(ConfigType& configuration, Keys const& keys) const
+      {
+        ConfigType item;
+        BOOST_FOREACH(std::string const& path, m_order)
+        {
+          const ConfigTree* value = NULL;
+          switch(prv_find(m_files.find(path)->second.fragment.configuration,
+                          keys, value))
+          {
+            case Declared: {
+              ConfigTree copy(*value);
+              item.splice(keys.back(), copy);
+              break;
+            }
+            case Replaced:
+              item.clear();
+              break;
+            case Absent:
+              break;
+          }
+        }
+
+        ConfigType* section = &configuration;
+        for(std::size_t i = 0; i + 1 < keys.size(); ++i) {
+          ConfigType::iterator it = section->find(keys[i]);
+          if(it == section->end() or
+             (section = boost::get<ConfigType>(&it->second)) == NULL)
+            return false;
+        }
+        ConfigType::iterator it = item.find(keys.back());
+        if(it == item.end())
+          section->erase(keys.back());
+        else
+          (*section)[keys.back()].swap(it->second);
+        return true;
+      }
+
+      // How a file declares the item.  An item is replaced if a section it
+      // is in is replaced by a value.
+      static Declaration prv_find(ConfigType const& configuration,
+                                  Keys const& keys, const ConfigTree*& value)
+      {
+        const ConfigType* section = &configuration;
+        for(std::size_t i = 0; i != keys.size(); ++i)
+        {
+          ConfigType::const_iterator it = section->find(keys[i]);
+          if(it == section->end())
+            return Absent;
+          if(i + 1 == keys.size()) {
+            value = &it->second;
+            return Declared;
+          }
+          section = boost::get<ConfigType>(&it->second);
+          if(section == NULL)
+            return Replaced;
+        }
+        return Absent;
+      }
+
+      // Find the sections that declare '#include_section' aliases, the
+      // section with the keys and every section in it.
+      static void prv_aliases(ConfigType const& section, Keys const& keys,
+                              std::set<Keys>& aliases)
+      {
+        BOOST_FOREACH(ConfigType::value_type const& item, section) {
+          if(const ConfigType* child = boost::get<ConfigType>(&item.second)) {
+            if(item.first == "$references")
+              aliases.insert(keys);
+            Keys childKeys(keys);
+            childKeys.push_back(item.first);
+            prv_aliases(*child, childKeys, aliases);
+          }
+        }
+      }
+
+      // Update the sections that declare aliases for the items that changed,
+      // walking only the changed items.
+      static void prv_aliases(ConfigType const& configuration,
+                              std::vector<Keys> const& affected,
+                              std::set<Keys>& aliases)
+      {
+        BOOST_FOREACH(Keys const& keys, affected)
+        {
+          Keys parent(keys.begin(), keys.end() - 1);
+          if(keys.back() == "$references")
+            aliases.erase(parent);
+          std::set<Keys>::iterator it = aliases.lower_bound(keys);
+          while(it != aliases.end() and it->size() >= keys.size() and
+                std::equal(keys.begin(), keys.end(), it->begin()))
+            aliases.erase(it++);
+
+          const ConfigTree* item = NULL;
+          const ConfigType* section = NULL;
+          if(prv_find(configuration, keys, item) == Declared and
+             (section = boost::get<ConfigType>(item)) != NULL) {
+            prv_aliases(*section, keys, aliases);
+            if(keys.back() == "$references")
+              aliases.insert(parent);
+          }
+        }
+      }
+
+      static void prv_buildIndex(Configuration& configuration,
+                                 std::set<Keys> const& aliases)
+      {
+        std::vector<const ConfigType*> sections;
+        BOOST_FOREACH(Keys const& keys, aliases)
+        {
+          const ConfigType* section = &configuration.m_configurationMap;
+          for(std::size_t i = 0; section and i != keys.size(); ++i) {
+            ConfigType::const_iterator it = section->find(keys[i]);
+            section = it == section->end()
+              ? NULL : boost::get<ConfigType>(&it->second);
+          }
+          if(section)
+            sections.push_back(section);
+        }
+        configuration.prv_buildIndex(sections);
+      }
+
+      void prv_publish(boost::shared_ptr<Configuration> const& configuration)
+      {
+        boost::atomic_store(&m_current, configuration);
+      }
+
+      // Watch the directories of the files, which also sees files that are
+      // replaced rather than written to.
+      void prv_watch()
+      {
+        std::set<std::string> watched;
+        typedef std::map<int, std::string>::value_type Directory;
+        BOOST_FOREACH(Directory const& directory, m_directories)
+          watched.insert(directory.second);
+
+        BOOST_FOREACH(Files::value_type const& file, m_files)
+        {
+          std::string directory =
+            boost::filesystem::path(file.first).parent_path().string();
+          if(not watched.insert(directory).second)
+            continue;
+          int watch = ::inotify_add_watch(m_inotify, directory.c_str(),
+                                          IN_CLOSE_WRITE | IN_MOVED_TO |
+                                          IN_ATTRIB);
+          if(watch < 0)
+            throw std::runtime_error("Could not watch configuration file: " +
+                                     file.first);
+          m_directories[watch] = directory;
+        }
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Members
+
+      parse::ParseOptions m_options;
+      boost::filesystem::path m_root;
+      Files m_files;
+      std::vector<std::string> m_order;
+
+      int m_inotify;
+      std::map<int, std::string> m_directories;
+
+      // The published configuration, the one published before it and the
+      // items that have changed since, which are merged in to it when it
+      // is reused.
+      boost::shared_ptr<Configuration> m_current;
+      boost::shared_ptr<Configuration> m_spare;
+      std::vector<Keys> m_stale;
+
+      // The keys of the sections that declare '#include_section' aliases.
+      std::set<Keys> m_aliases;
+
+      boost::mutex m_updateMutex;
+  };
+
+} // namespace libconfig
+
+#endif // _libconfig_watch_included_
@@ -0,0 +1,242 @@
+#ifndef _libconfig_benchmark_generator_included_
+#define _libconfig_benchmark_generator_included_
+
+// A generator of synthetic configurations for the benchmarks.  The
+// configuration is written to a directory as a top level file that includes
+// 'fanOut' other files.  Every file declares 'sections' top level sections
+// nested 'depth' deep, each holding 'values' of every kind of value, lists
+// of 'listLength' items, strings with 'references' '${}' references and a
+// chain of 'aliases' '#include_section' aliases, each naming the one before.
+//
+// The addresses of the values written are collected by kind so that the
+// benchmarks can look them up.
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+namespace benchmark {
+
+  struct GeneratorOptions
+  {
+    GeneratorOptions()
+      : sections(100)
+      , depth(3)
+      , values(4)
+      , listLength(8)
+      , fanOut(4)
+      , aliases(3)
+      , references(1)
+    {}
+
+    // Set an option from a 'name=value' argument.  Returns false if the
+    // argument does not name an option.
+    bool set(std::string const& argument)
+    {
+      std::string::size_type equals = argument.find('=');
+      if(equals == std::string::npos)
+        return false;
+      std::string name = argument.substr(0, equals);
+      int value = std::atoi(argument.c_str() + equals + 1);
+      if(name == "sections")        sections = value;
+      else if(name == "depth")      depth = value;
+      else if(name == "values")     values = value;
+      else if(name == "lists")      listLength = value;
+      else if(name == "fanout")     fanOut = value;
+      else if(name == "aliases")    aliases = value;
+      else if(name == "references") references = value;
+      else return false;
+      return true;
+    }
+
+    std::string describe() const
+    {
+      return boost::str(boost::format(
+              "sections=%1% depth=%2% values=%3% lists=%4% fanout=%5% "
+              "aliases=%6% references=%7%")
+              % sections % depth % values % listLength % fanOut % aliases
+              % references);
+    }
+
+    int sections;
+    int depth;
+    int values;
+    int listLength;
+    int fanOut;
+    int aliases;
+    int references;
+  };
+
+  // The addresses of the generated values, by kind.
+  struct Addresses
+  {
+    std::vector<std::string> numbers;
+    std::vector<std::string> bools;
+    std::vector<std::string> strings;
+    std::vector<std::string> references;
+    std::vector<std::string> stringLists;
+    std::vector<std::string> numberLists;
+    std::vector<std::string> sections;
+    std::vector<std::string> aliased;
+    std::vector<std::string> missing;
+  };
+
+  class Generator
+  {
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Construction
+
+      Generator(GeneratorOptions const& options,
+                boost::filesystem::path const& directory)
+        : m_options(options)
+        , m_directory(directory)
+        , m_bytes(0)
+      {}
+
+    public:
+      // :: -------------------------------------------------------------------
+      // :: Public Interface
+
+      // Write the files and return the path of the top level file.
+      std::string write()
+      {
+        boost::filesystem::create_directories(m_directory);
+        for(int file = 1; file <= m_options.fanOut; ++file)
+          prv_writeFile(file, prv_fileName(file), "");
+
+        std::ostringstream includes;
+        for(int file = 1; file <= m_options.fanOut; ++file)
+          includes << "#include \"" << prv_fileName(file) << "\"\n";
+        return prv_writeFile(0, "main.cfg", includes.str());
+      }
+
+      Addresses const& addresses() const { return m_addresses; }
+
+      // The total size of the files written.
+      std::size_t bytes() const { return m_bytes; }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Private Member Functions
+
+      static std::string prv_fileName(int file)
+      {
+        return boost::str(boost::format("part_%1%.cfg") % file);
+      }
+
+      std::string prv_writeFile(int file, std::string const& name,
+                                std::string const& header)
+      {
+        std::ostringstream out;
+        out << header;
+        for(int section = 0; section < m_options.sections; ++section)
+        {
+          std::string key = boost::str(boost::format("f%1%_s%2%")
+                                       % file % section);
+          prv_writeSection(out, key, key, 0);
+        }
+
+        std::string path = (m_directory / name).string();
+        std::ofstream stream(path.c_str());
+        std::string const& text = out.str();
+        stream.write(text.data(), text.size());
+        if(not stream)
+          throw std::runtime_error("Unable to write " + path);
+        m_bytes += text.size();
+        return path;
+      }
+
+      void prv_writeSection(std::ostringstream& out, std::string const& key,
+                            std::string const& address, int level)
+      {
+        std::string indent(level * 2, ' ');
+        out << indent << key << ": {\n";
+        m_addresses.sections.push_back(address);
+
+        for(int v = 0; v < m_options.values; ++v)
+        {
+          prv_writeValue(out, indent, address, "number", v,
+                         m_addresses.numbers)
+            << (v * 7 + level) << ".25;\n";
+          prv_writeValue(out, indent, address, "flag", v, m_addresses.bools)
+            << (v % 2 ? "true" : "false") << ";\n";
+          prv_writeValue(out, indent, address, "name", v, m_addresses.strings)
+            << "\"" << address << " value " << v << "\";\n";
+
+          prv_writeValue(out, indent, address, "hosts", v,
+                         m_addresses.stringLists) << "(";
+          for(int i = 0; i < m_options.listLength; ++i)
+            out << (i ? ", " : "") << "\"host" << i << ".example.com\"";
+          out << ");\n";
+
+          prv_writeValue(out, indent, address, "weights", v,
+                         m_addresses.numberLists) << "(";
+          for(int i = 0; i < m_options.listLength; ++i)
+            out << (i ? ", " : "") << i << ".5";
+          out << ");\n";
+
+          m_addresses.missing.push_back(
+              boost::str(boost::format("%1%.absent%2%") % address % v));
+        }
+
+        if(m_options.references > 0 and m_options.values > 0)
+        {
+          prv_writeValue(out, indent, address, "url", 0,
+                         m_addresses.references) << "\"";
+          for(int r = 0; r < m_options.references; ++r)
+            out << "/${" << address << ".name" << (r % m_options.values)
+                << "}";
+          out << "\";\n";
+        }
+
+        // A chain of aliases of the child section, each naming the one
+        // before it.
+        if(level == 0 and m_options.aliases > 0 and m_options.depth > 1)
+        {
+          out << indent << "  #include_section \"" << address
+              << ".child\" as \"alias0\"\n";
+          for(int a = 1; a < m_options.aliases; ++a)
+            out << indent << "  #include_section \"alias" << (a - 1)
+                << "\" as \"alias" << a << "\"\n";
+          m_addresses.aliased.push_back(
+              boost::str(boost::format("%1%.alias%2%.number0")
+                         % address % (m_options.aliases - 1)));
+        }
+
+        if(level + 1 < m_options.depth)
+          prv_writeSection(out, "child", address + ".child", level + 1);
+        out << indent << "};\n";
+      }
+
+      // Write the key of a value and record its address.
+      static std::ostringstream& prv_writeValue(
+          std::ostringstream& out, std::string const& indent,
+          std::string const& address, const char* name, int v,
+          std::vector<std::string>& addresses)
+      {
+        out << indent << "  " << name << v << " = ";
+        addresses.push_back(
+            boost::str(boost::format("%1%.%2%%3%") % address % name % v));
+        return out;
+      }
+
+    private:
+      // :: -------------------------------------------------------------------
+      // :: Members
+
+      GeneratorOptions m_options;
+      boost::filesystem::path m_directory;
+      Addresses m_addresses;
+      std::size_t m_bytes;
+  };
+
+} // namespace benchmark
+
+#endif // _libconfig_benchmark_generator_included_
@@ -0,0 +1,122 @@
+// Lookup benchmark: N threads sharing one Configuration, each looking up a
+// mix of scalar, list and '${}' string values.  Lookups do not modify the
+// configuration, so the throughput should grow linearly with the number of
+// threads up to the number of cores.
+//
+//   benchmark/lookup [max threads] [lookups per thread]
+
+#include "Libconfig.h"
+
+#include <ctime>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/bind/bind.hpp>
+#include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
+
+using namespace libconfig;
+
+// A configuration of 1000 sections of scalars, lists and strings with
+// references to other items.
+ConfigType makeConfiguration()
+{
+  ConfigType configuration;
+  for(int i = 0; i < 1000; ++i)
+  {
+    ConfigType section;
+    section["enabled"] = true;
+    section["port"] = double(8000 + i);
+    section["name"] = boost::str(boost::format("service-%1%") % i);
+    section["hosts"] = std::vector<std::string>(4, "host.example.com");
+    section["weights"] = std::vector<double>(8, 0.5);
+    section["url"] = boost::str(boost::format(
+        "http://${section_%1%.name}:${section_%1%.port}/") % i);
+    configuration[boost::str(boost::format("section_%1%") % i)] = section;
+  }
+  return configuration;
+}
+
+struct Addresses
+{
+  Addresses(int i)
+    : port(boost::str(boost::format("section_%1%.port") % i))
+    , enabled(boost::str(boost::format("section_%1%.enabled") % i))
+    , hosts(boost::str(boost::format("section_%1%.hosts") % i))
+    , url(boost::str(boost::format("section_%1%.url") % i))
+  {}
+
+  ConfigPath port, enabled, hosts, url;
+};
+
+void lookups(const Configuration* configuration, 
+             const std::vector<Addresses>* addresses, long count)
+{
+  double port;
+  bool enabled;
+  std::vector<std::string> hosts;
+  std::string url;
+  for(long i = 0; i < count; i += 4)
+  {
+    Addresses const& a = (*addresses)[(i / 4) % addresses->size()];
+    configuration->lookupValue(a.port, port);
+    configuration->lookupValue(a.enabled, enabled);
+    configuration->lookupValue(a.hosts, hosts);
+    configuration->lookupValue(a.url, url);
+  }
+}
+
+double seconds()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void run(const char* name, const Configuration& configuration,
+         const std::vector<Addresses>& addresses, 
+         unsigned maxThreads, long count)
+{
+  double single = 0;
+  for(unsigned threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    double start = seconds();
+    boost::thread_group group;
+    for(unsigned i = 0; i < threads; ++i)
+      group.create_thread(boost::bind(lookups, &configuration, &addresses, 
+                                      count));
+    group.join_all();
+    double rate = threads * count / (seconds() - start);
+    if(threads == 1)
+      single = rate;
+    std::cout << boost::format("%-10s %3d threads %8.2f M lookups/s"
+                               "  %5.2fx\n")
+                 % name % threads % (rate / 1e6) % (rate / single);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  unsigned maxThreads = argc > 1 ? std::atoi(argv[1])
+                                 : boost::thread::hardware_concurrency();
+  long count = argc > 2 ? std::atol(argv[2]) : 1000000;
+  if(maxThreads == 0)
+    maxThreads = 1;
+
+  std::vector<Addresses> addresses;
+  for(int i = 0; i < 1000; i += 7)
+    addresses.push_back(Addresses(i));
+
+  Configuration configuration(makeConfiguration());
+  run("map", configuration, addresses, maxThreads, count);
+
+  configuration.resolveReferences();
+  run("resolved", configuration, addresses, maxThreads, count);
+
+  configuration.compact();
+  run("compact", configuration, addresses, maxThreads, count);
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+// Merge benchmark: parse files that declare the same sections over and over,
+// so that most of the work is merging sections in to the ones declared
+// before.  Each repetition declares every section nested 'depth' deep again,
+// adding a key of its own and overwriting a shared one at every level.  The
+// file is doubled in size a number of times; the time per byte should stay
+// about the same as the file grows, however deeply the sections are nested.
+//
+//   benchmark/merge [repetitions] [depth] [doublings]
+
+#include "Libconfig.h"
+
+#include <ctime>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+using namespace libconfig;
+
+// 'repetitions' declarations of the sections 'a' and 'b', each nested
+// 'depth' deep.
+std::string makeConfiguration(int repetitions, int depth)
+{
+  std::ostringstream out;
+  for(int r = 0; r < repetitions; ++r)
+  {
+    for(int s = 0; s < 2; ++s)
+    {
+      for(int level = 0; level < depth; ++level)
+        out << std::string(level * 2, ' ') << (s ? "b" : "a") << level
+            << ": {\n";
+      for(int level = depth - 1; level >= 0; --level) {
+        std::string indent((level + 1) * 2, ' ');
+        out << indent << "shared = " << r << ";\n"
+            << indent << "key" << r << " = \"value " << r << "\";\n"
+            << std::string(level * 2, ' ') << "};\n";
+      }
+    }
+  }
+  return out.str();
+}
+
+double seconds()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Parse the file and return the time taken, the best of three.
+double parseTime(std::string const& filename, parse::ParserType parser)
+{
+  double best = 0;
+  for(int i = 0; i < 3; ++i)
+  {
+    double start = seconds();
+    parse::parseConfigFile(filename, parse::ParseOptions(parser));
+    double elapsed = seconds() - start;
+    if(i == 0 or elapsed < best)
+      best = elapsed;
+  }
+  return best;
+}
+
+int main(int argc, char **argv)
+{
+  int repetitions = argc > 1 ? std::atoi(argv[1]) : 500;
+  int depth = argc > 2 ? std::atoi(argv[2]) : 6;
+  int doublings = argc > 3 ? std::atoi(argv[3]) : 5;
+
+  boost::filesystem::path path = boost::filesystem::temp_directory_path() /
+    boost::filesystem::unique_path("libconfig-%%%%-%%%%.cfg");
+
+  std::cout << boost::format("depth %d\n%12s %10s %22s %22s\n")
+               % depth % "repetitions" % "bytes" % "spirit" % "descent";
+  for(int i = 0; i < doublings; ++i, repetitions *= 2)
+  {
+    std::string text = makeConfiguration(repetitions, depth);
+    {
+      std::ofstream file(path.string().c_str());
+      file.write(text.data(), text.size());
+    }
+    double spirit = parseTime(path.string(), parse::SpiritParser);
+    double descent = parseTime(path.string(), parse::DescentParser);
+    std::cout << boost::format("%12d %10d %9.2f ms %5.1f ns/B "
+                               "%9.2f ms %5.1f ns/B\n")
+                 % repetitions % text.size()
+                 % (spirit * 1e3) % (spirit / text.size() * 1e9)
+                 % (descent * 1e3) % (descent / text.size() * 1e9);
+  }
+  boost::filesystem::remove(path);
+  return 0;
+}
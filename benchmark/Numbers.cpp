@@ -0,0 +1,203 @@
+// Numbers benchmark: parse files made of nothing but numbers of one kind,
+// small and 64 bit integers, hexadecimal integers, doubles with a fraction
+// or an exponent and lists of integers and of doubles, with both parsers.
+// The files hold 'count' values each, 100 to a section, and every file is
+// parsed three times, the best time is reported.  The time parse::Number
+// takes to scan the numbers alone is reported per number, next to the time
+// strtod takes to read the same characters.
+//
+//   benchmark/numbers [count]
+
+#include "Libconfig.h"
+
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+using namespace libconfig;
+
+// Write value 'i' of a kind of number.
+typedef void (*Writer)(std::ostringstream& out, int i);
+
+void writeInt(std::ostringstream& out, int i)
+{
+  out << (i * 7919) % 1000000 - 500000;
+}
+
+void writeInt64(std::ostringstream& out, int i)
+{
+  out << 1000000000000LL + i * 7919LL;
+}
+
+void writeHex(std::ostringstream& out, int i)
+{
+  char buffer[16];
+  std::snprintf(buffer, sizeof(buffer), "0x%08x", i * 7919u);
+  out << buffer;
+}
+
+void writeDouble(std::ostringstream& out, int i)
+{
+  out << (i * 7919) % 100000 << '.' << (i % 1000);
+}
+
+void writeExponent(std::ostringstream& out, int i)
+{
+  out << (i % 9 + 1) << '.' << (i * 7919) % 1000 << "e-" << (i % 30);
+}
+
+void writeIntList(std::ostringstream& out, int i)
+{
+  out << '(';
+  for(int j = 0; j < 16; ++j)
+    out << (j ? ", " : "") << i + j * 31;
+  out << ')';
+}
+
+void writeDoubleList(std::ostringstream& out, int i)
+{
+  out << '(';
+  for(int j = 0; j < 16; ++j)
+    out << (j ? ", " : "") << i + j << '.' << j * 3;
+  out << ')';
+}
+
+std::string makeConfiguration(Writer writer, int count)
+{
+  std::ostringstream out;
+  for(int i = 0; i < count; ++i)
+  {
+    if(i % 100 == 0)
+      out << (i ? "};\n" : "") << "section" << i / 100 << ": {\n";
+    out << "  value" << i % 100 << " = ";
+    writer(out, i);
+    out << ";\n";
+  }
+  out << "};\n";
+  return out.str();
+}
+
+double seconds()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// The numbers of a configuration, one to a line.
+std::string numbers(std::string const& text)
+{
+  std::string out;
+  std::string::size_type p = 0;
+  while((p = text.find_first_of("=(,", p)) != std::string::npos)
+  {
+    p = text.find_first_not_of(" (", p + 1);
+    std::string::size_type end = text.find_first_of(",);", p);
+    out.append(text, p, end - p);
+    out += '\n';
+    p = end;
+  }
+  return out;
+}
+
+// Scan every number with parse::Number or with strtod and return the time
+// taken per number, the best of three.
+double scanTime(std::string const& numbers, bool useStrtod, double& sum)
+{
+  double best = 0;
+  for(int i = 0; i < 3; ++i)
+  {
+    std::size_t count = 0;
+    double start = seconds();
+    const char* p = numbers.data();
+    const char* last = p + numbers.size();
+    while(p != last)
+    {
+      if(useStrtod) {
+        char* end;
+        sum += std::strtod(p, &end);
+        p = end + 1;
+      }
+      else {
+        parse::Number number;
+        p = number.scan(p, last) + 1;
+        sum += number.real();
+      }
+      ++count;
+    }
+    double elapsed = (seconds() - start) / count;
+    if(i == 0 or elapsed < best)
+      best = elapsed;
+  }
+  return best;
+}
+
+// Parse the file and return the time taken, the best of three.
+double parseTime(std::string const& filename, parse::ParserType parser)
+{
+  double best = 0;
+  for(int i = 0; i < 3; ++i)
+  {
+    double start = seconds();
+    parse::parseConfigFile(filename, parse::ParseOptions(parser));
+    double elapsed = seconds() - start;
+    if(i == 0 or elapsed < best)
+      best = elapsed;
+  }
+  return best;
+}
+
+int main(int argc, char **argv)
+{
+  int count = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+  struct Kind { const char* name; Writer writer; };
+  const Kind kinds[] = {
+    { "int", writeInt },
+    { "int64", writeInt64 },
+    { "hex", writeHex },
+    { "double", writeDouble },
+    { "exponent", writeExponent },
+    { "int list", writeIntList },
+    { "double list", writeDoubleList }
+  };
+
+  boost::filesystem::path path = boost::filesystem::temp_directory_path() /
+    boost::filesystem::unique_path("libconfig-%%%%-%%%%.cfg");
+
+  std::cout << boost::format("%-12s %10s %22s %22s %12s %12s\n")
+               % "values" % "bytes" % "spirit" % "descent" % "scan"
+               % "strtod";
+  double sum = 0;
+  for(std::size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); ++k)
+  {
+    std::string text = makeConfiguration(kinds[k].writer, count);
+    {
+      std::ofstream file(path.string().c_str());
+      file.write(text.data(), text.size());
+    }
+    double spirit = parseTime(path.string(), parse::SpiritParser);
+    double descent = parseTime(path.string(), parse::DescentParser);
+    std::string values = numbers(text);
+    double scan = scanTime(values, false, sum);
+    double library = scanTime(values, true, sum);
+    std::cout << boost::format("%-12s %10d %9.2f ms %5.1f ns/B "
+                               "%9.2f ms %5.1f ns/B %7.1f ns/n %7.1f ns/n\n")
+                 % kinds[k].name % text.size()
+                 % (spirit * 1e3) % (spirit / text.size() * 1e9)
+                 % (descent * 1e3) % (descent / text.size() * 1e9)
+                 % (scan * 1e9) % (library * 1e9);
+  }
+  boost::filesystem::remove(path);
+  // Keep the sums of the numbers scanned from being optimised away.
+  if(sum == 0.5)
+    std::cout << sum << std::endl;
+  return 0;
+}
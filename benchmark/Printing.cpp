@@ -0,0 +1,183 @@
+// Printing benchmark: write a configuration with the ConfigPrinter, which
+// prints to std::cout, and with the ConfigWriter to a file descriptor and
+// to memory.  The written configuration is then parsed with both parsers to
+// check that it reads back as the configuration that was written.  Doubles
+// that read back off by one unit in the last place are reported apart from
+// those that differ.
+//
+//   benchmark/printing [sections] [repetitions]
+
+#include "Libconfig.h"
+
+#include <cmath>
+#include <ctime>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+using namespace libconfig;
+
+// A configuration of sections of scalars, lists, strings that need escaping
+// and '#include_section' aliases.
+ConfigType makeConfiguration(int sections)
+{
+  ConfigType configuration;
+  for(int i = 0; i < sections; ++i)
+  {
+    ConfigType section;
+    section["enabled"] = i % 2 == 0;
+    section["port"] = 8000 + i;
+    section["bytes"] = boost::int64_t(i) << 32;
+    section["ratio"] = 1.0 / (i + 3);
+    section["name"] = boost::str(boost::format("service-%1%") % i);
+    section["quoted"] = std::string("say \"hi\"\tC:\\temp\n\x01" "2");
+    section["hosts"] = std::vector<std::string>(4, "host.example.com");
+    section["weights"] = std::vector<double>(8, 0.1 * i);
+    section["empty"] = std::vector<boost::none_t>();
+    if(i > 0) {
+      ConfigType references;
+      references["previous"] = boost::str(boost::format("section_%1%")
+                                          % (i - 1));
+      section["$references"] = references;
+    }
+    configuration[boost::str(boost::format("section_%1%") % i)] = section;
+  }
+  return configuration;
+}
+
+double seconds()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void report(const char* name, double elapsed, std::size_t bytes)
+{
+  std::cout << boost::format("%-16s %8.2f ms %8.1f MB/s\n")
+               % name % (elapsed * 1e3) % (bytes / elapsed / 1e6);
+}
+
+// Compare two items, allowing doubles to differ by one unit in the last
+// place if 'nearby' is set.
+struct Same : boost::static_visitor<bool>
+{
+  explicit Same(bool nearby)
+    : nearby(nearby)
+  {}
+
+  template<typename T, typename U>
+  bool operator()(T const&, U const&) const { return false; }
+
+  template<typename T>
+  bool operator()(T const& a, T const& b) const { return a == b; }
+
+  bool operator()(double a, double b) const
+  {
+    return a == b or (nearby and (std::nextafter(a, b) == b));
+  }
+
+  bool operator()(std::vector<double> const& a,
+                  std::vector<double> const& b) const
+  {
+    if(a.size() != b.size())
+      return false;
+    for(std::size_t i = 0; i < a.size(); ++i)
+      if(not (*this)(a[i], b[i]))
+        return false;
+    return true;
+  }
+
+  bool operator()(std::vector<boost::none_t> const&,
+                  std::vector<boost::none_t> const&) const
+  {
+    return true;
+  }
+
+  bool operator()(ConfigType const& a, ConfigType const& b) const
+  {
+    if(a.size() != b.size())
+      return false;
+    for(ConfigType::const_iterator i = a.begin(), j = b.begin();
+        i != a.end(); ++i, ++j)
+      if(i->first != j->first or
+         not boost::apply_visitor(*this, i->second, j->second))
+        return false;
+    return true;
+  }
+
+  bool nearby;
+};
+
+bool roundTrip(const char* name, std::string const& filename,
+               parse::ParserType parser, ConfigType const& expected)
+{
+  ConfigType result = parse::parseConfigFile(filename,
+                                             parse::ParseOptions(parser));
+  const char* outcome = "DIFFERS";
+  if(Same(false)(result, expected))
+    outcome = "ok";
+  else if(Same(true)(result, expected))
+    outcome = "ok within one ulp";
+  std::cout << boost::format("round trip %-8s %s\n") % name % outcome;
+  return outcome[0] == 'o';
+}
+
+int main(int argc, char **argv)
+{
+  int sections = argc > 1 ? std::atoi(argv[1]) : 10000;
+  int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+
+  ConfigType configuration = makeConfiguration(sections);
+  std::string text = printing::configToString(configuration);
+  std::size_t bytes = text.size() * repetitions;
+
+  std::ofstream null("/dev/null");
+  std::streambuf* out = std::cout.rdbuf(null.rdbuf());
+  double start = seconds();
+  for(int i = 0; i < repetitions; ++i)
+    printing::ConfigPrinter()(configuration);
+  double printer = seconds() - start;
+  std::cout.rdbuf(out);
+  report("ConfigPrinter", printer, bytes);
+
+  int fd = open("/dev/null", O_WRONLY);
+  start = seconds();
+  for(int i = 0; i < repetitions; ++i) {
+    printing::OutputBuffer output(fd);
+    printing::writeConfig(configuration, output);
+    output.flush();
+  }
+  report("ConfigWriter fd", seconds() - start, bytes);
+  close(fd);
+
+  printing::OutputBuffer memory;
+  start = seconds();
+  for(int i = 0; i < repetitions; ++i) {
+    memory.clear();
+    printing::writeConfig(configuration, memory);
+  }
+  report("ConfigWriter mem", seconds() - start, bytes);
+
+  boost::filesystem::path path = boost::filesystem::temp_directory_path() /
+    boost::filesystem::unique_path("libconfig-%%%%-%%%%.cfg");
+  {
+    std::ofstream file(path.string().c_str());
+    printing::OutputBuffer output(file);
+    output.append(text);
+  }
+  bool same = roundTrip("spirit", path.string(), parse::SpiritParser,
+                        configuration);
+  same = roundTrip("descent", path.string(), parse::DescentParser,
+                   configuration) and same;
+  boost::filesystem::remove(path);
+  return same ? 0 : 1;
+}
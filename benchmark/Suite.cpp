@@ -0,0 +1,454 @@
+// Benchmark suite: generates a synthetic configuration and measures parsing,
+// include expansion, loading, lookups by type, failed lookups reported by
+// exception and by status, batch lookups, queries, reference resolution
+// and printing.  Every benchmark runs in a process of its own so that the
+// peak resident size reported is the one of that benchmark.
+//
+//   benchmark/suite [option=value ...] [benchmark ...]
+//
+// The options are those of benchmark::GeneratorOptions and 'repetitions'
+// and 'lookups'.  Benchmarks are selected by the start of their names, all
+// of them are run if none is given.
+
+#include "Libconfig.h"
+#include "Generator.h"
+
+#include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <boost/bind/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+#include <boost/function.hpp>
+
+using namespace libconfig;
+
+struct Settings
+{
+  Settings()
+    : repetitions(5)
+    , lookups(1000000)
+  {}
+
+  std::string filename;
+  std::size_t bytes;
+  benchmark::Addresses addresses;
+  int repetitions;
+  long lookups;
+};
+
+double seconds()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+double peakRSS()
+{
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0;
+}
+
+void reportRate(const char* name, double elapsed, double bytes)
+{
+  std::cout << boost::format("%-24s %10.2f ms %10.1f MB/s  %8.1f MB peak\n")
+               % name % (elapsed * 1e3) % (bytes / elapsed / 1e6)
+               % peakRSS();
+}
+
+void reportLookups(const char* name, double elapsed, double count)
+{
+  std::cout << boost::format("%-24s %10.2f ms %10.1f ns/op  %8.1f MB peak\n")
+               % name % (elapsed * 1e3) % (elapsed / count * 1e9)
+               % peakRSS();
+}
+
+// :: -------------------------------------------------------------------------
+// :: Parsing and loading
+
+void parseFiles(Settings const& settings, parse::ParserType parser,
+                const char* name)
+{
+  double start = seconds();
+  for(int i = 0; i < settings.repetitions; ++i)
+    parse::parseConfigFile(settings.filename, parse::ParseOptions(parser));
+  reportRate(name, (seconds() - start) / settings.repetitions,
+             settings.bytes);
+}
+
+void expandIncludes(Settings const& settings)
+{
+  double start = seconds();
+  std::size_t size = 0;
+  for(int i = 0; i < settings.repetitions; ++i)
+    size = parse::SourceChain(settings.filename).size();
+  reportRate("include expansion", (seconds() - start) / settings.repetitions,
+             size);
+}
+
+void load(Settings const& settings, parse::ParseOptions const& options,
+          const char* name)
+{
+  double start = seconds();
+  for(int i = 0; i < settings.repetitions; ++i)
+    Configuration configuration(settings.filename, options);
+  reportRate(name, (seconds() - start) / settings.repetitions,
+             settings.bytes);
+}
+
+// :: -------------------------------------------------------------------------
+// :: Lookups
+
+// Look up 'count' values of the addresses in turn.
+template<typename T>
+void lookups(Settings const& settings,
+             std::vector<std::string> const& addresses, long count,
+             const char* name)
+{
+  if(addresses.empty())
+    return;
+  Configuration configuration(settings.filename,
+                              parse::ParseOptions(parse::DescentParser));
+  std::vector<ConfigPath> paths;
+  BOOST_FOREACH(std::string const& address, addresses)
+    paths.push_back(ConfigPath(address));
+
+  T value;
+  long found = 0;
+  double start = seconds();
+  for(long i = 0; i < count; ++i)
+    found += configuration.lookupValue(paths[i % paths.size()], value);
+  double elapsed = seconds() - start;
+  if(found != 0 and found != count)
+    std::cerr << name << ": only " << found << " lookups found a value\n";
+  reportLookups(name, elapsed, count);
+}
+
+// Look up 'count' values of the addresses in turn that are all missing or
+// of another type than T, catching the errors lookupValue throws or
+// checking the status tryLookupValue returns.
+template<typename T>
+void failedLookups(Settings const& settings,
+                   std::vector<std::string> const& addresses, long count,
+                   bool status, const char* name)
+{
+  if(addresses.empty())
+    return;
+  Configuration configuration(settings.filename,
+                              parse::ParseOptions(parse::DescentParser));
+  std::vector<ConfigPath> paths;
+  BOOST_FOREACH(std::string const& address, addresses)
+    paths.push_back(ConfigPath(address));
+
+  T value;
+  long failed = 0;
+  double start = seconds();
+  for(long i = 0; i < count; ++i)
+  {
+    ConfigPath const& path = paths[i % paths.size()];
+    if(status) {
+      failed += configuration.tryLookupValue(path, value) != LookupFound;
+      continue;
+    }
+    try {
+      configuration.lookupValue(path, value);
+    }
+    catch(std::runtime_error const&) {
+      ++failed;
+    }
+  }
+  double elapsed = seconds() - start;
+  if(failed != count)
+    std::cerr << name << ": " << (count - failed) << " lookups succeeded\n";
+  reportLookups(name, elapsed, count);
+}
+
+// Look up the numbers and strings of the configuration as a component
+// reading its settings at startup would: one address at a time, in a
+// batch built for the lookup, and in a batch built beforehand.
+void batchLookups(Settings const& settings)
+{
+  Configuration configuration(settings.filename,
+                              parse::ParseOptions(parse::DescentParser));
+  benchmark::Addresses const& a = settings.addresses;
+  std::vector<double> numbers(a.numbers.size());
+  std::vector<std::string> strings(a.strings.size());
+  double count = settings.repetitions * (numbers.size() + strings.size());
+
+  double start = seconds();
+  for(int r = 0; r < settings.repetitions; ++r) {
+    for(std::size_t i = 0; i != numbers.size(); ++i)
+      configuration.lookupValue(a.numbers[i], numbers[i]);
+    for(std::size_t i = 0; i != strings.size(); ++i)
+      configuration.lookupValue(a.strings[i], strings[i]);
+  }
+  reportLookups("startup lookupValue", seconds() - start, count);
+
+  LookupBatch prepared;
+  start = seconds();
+  for(int r = 0; r < settings.repetitions; ++r) {
+    LookupBatch batch;
+    batch.reserve(numbers.size() + strings.size());
+    for(std::size_t i = 0; i != numbers.size(); ++i)
+      batch.add(a.numbers[i], numbers[i]);
+    for(std::size_t i = 0; i != strings.size(); ++i)
+      batch.add(a.strings[i], strings[i]);
+    if(batch.lookup(configuration) != batch.size())
+      std::cerr << "batch: " << batch.failed().size() << " not found\n";
+    if(r == 0)
+      prepared = batch;
+  }
+  reportLookups("startup batch", seconds() - start, count);
+
+  start = seconds();
+  for(int r = 0; r < settings.repetitions; ++r)
+    prepared.lookup(configuration);
+  reportLookups("startup batch prepared", seconds() - start, count);
+}
+
+// Build the path index with the first query, then query by prefix, by
+// last key and with a pattern that has to be matched against every
+// address.
+void queries(Settings const& settings)
+{
+  Configuration configuration(settings.filename,
+                              parse::ParseOptions(parse::DescentParser));
+  std::vector<std::string> addresses;
+  double start = seconds();
+  configuration.enumerate("f1_s0", addresses);
+  reportLookups("query index build", seconds() - start, 1);
+
+  const char* patterns[][2] = {
+    { "query prefix", "f1_s1.*" },
+    { "query last key", "*.name0" },
+    { "query scan", "*name*" }
+  };
+  for(std::size_t p = 0; p != sizeof(patterns) / sizeof(patterns[0]); ++p)
+  {
+    start = seconds();
+    for(int i = 0; i < settings.repetitions; ++i) {
+      addresses.clear();
+      configuration.query(patterns[p][1], addresses);
+    }
+    reportLookups(patterns[p][0], seconds() - start, settings.repetitions);
+  }
+}
+
+void resolveReferences(Settings const& settings)
+{
+  Configuration loaded(settings.filename,
+                       parse::ParseOptions(parse::DescentParser));
+  double elapsed = 0;
+  for(int i = 0; i < settings.repetitions; ++i)
+  {
+    Configuration configuration(loaded);
+    double start = seconds();
+    configuration.resolveReferences();
+    elapsed += seconds() - start;
+  }
+  reportLookups("resolve references", elapsed / settings.repetitions,
+                std::max<std::size_t>(settings.addresses.references.size(),
+                                      1));
+}
+
+// :: -------------------------------------------------------------------------
+// :: Printing
+
+void printConfig(Settings const& settings)
+{
+  ConfigType configuration = parse::parseConfigFile(settings.filename,
+      parse::ParseOptions(parse::DescentParser));
+  std::size_t bytes = printing::configToString(configuration).size();
+
+  std::ofstream null("/dev/null");
+  std::streambuf* out = std::cout.rdbuf(null.rdbuf());
+  double start = seconds();
+  for(int i = 0; i < settings.repetitions; ++i)
+    printing::ConfigPrinter()(configuration);
+  double elapsed = seconds() - start;
+  std::cout.rdbuf(out);
+  reportRate("print ConfigPrinter", elapsed / settings.repetitions, bytes);
+
+  int fd = open("/dev/null", O_WRONLY);
+  start = seconds();
+  for(int i = 0; i < settings.repetitions; ++i) {
+    printing::OutputBuffer output(fd);
+    printing::writeConfig(configuration, output);
+    output.flush();
+  }
+  elapsed = seconds() - start;
+  close(fd);
+  reportRate("print ConfigWriter", elapsed / settings.repetitions, bytes);
+}
+
+// :: -------------------------------------------------------------------------
+// :: Running
+
+typedef boost::function<void ()> Benchmark;
+
+// Run a benchmark in a child process.
+void isolated(Benchmark const& benchmark)
+{
+  std::cout.flush();
+  pid_t child = fork();
+  if(child < 0) {
+    std::perror("fork");
+    std::exit(1);
+  }
+  if(child == 0) {
+    int status = 0;
+    try {
+      benchmark();
+    }
+    catch(std::exception const& e) {
+      std::cerr << e.what() << std::endl;
+      status = 1;
+    }
+    std::cout.flush();
+    _exit(status);
+  }
+  int status;
+  waitpid(child, &status, 0);
+}
+
+bool selected(std::vector<std::string> const& names, std::string const& name)
+{
+  if(names.empty())
+    return true;
+  BOOST_FOREACH(std::string const& prefix, names)
+    if(name.compare(0, prefix.size(), prefix) == 0)
+      return true;
+  return false;
+}
+
+int main(int argc, char **argv)
+{
+  benchmark::GeneratorOptions options;
+  Settings settings;
+  std::vector<std::string> names;
+  for(int i = 1; i < argc; ++i)
+  {
+    std::string argument = argv[i];
+    if(options.set(argument))
+      continue;
+    if(argument.compare(0, 12, "repetitions=") == 0)
+      settings.repetitions = std::max(1, std::atoi(argv[i] + 12));
+    else if(argument.compare(0, 8, "lookups=") == 0)
+      settings.lookups = std::max(1L, std::atol(argv[i] + 8));
+    else
+      names.push_back(argument);
+  }
+
+  boost::filesystem::path directory =
+    boost::filesystem::temp_directory_path() /
+    boost::filesystem::unique_path("libconfig-suite-%%%%-%%%%");
+  benchmark::Generator generator(options, directory);
+  settings.filename = generator.write();
+  settings.bytes = generator.bytes();
+  settings.addresses = generator.addresses();
+
+  std::cout << options.describe() << "\n"
+            << boost::format("%1% files, %2% bytes\n\n")
+               % (options.fanOut + 1) % settings.bytes;
+
+  benchmark::Addresses const& a = settings.addresses;
+  parse::ParseOptions lazy(parse::DescentParser);
+  lazy.lazy = true;
+
+  // Addresses that go through a value as if it were a section.
+  std::vector<std::string> belowValues;
+  BOOST_FOREACH(std::string const& address, a.numbers)
+    belowValues.push_back(address + ".below");
+
+  typedef std::pair<std::string, Benchmark> Entry;
+  std::vector<Entry> benchmarks;
+  Settings const& s = settings;
+  long n = settings.lookups;
+  benchmarks.push_back(Entry("parse spirit", boost::bind(
+      parseFiles, boost::cref(s), parse::SpiritParser, "parse spirit")));
+  benchmarks.push_back(Entry("parse descent", boost::bind(
+      parseFiles, boost::cref(s), parse::DescentParser, "parse descent")));
+  benchmarks.push_back(Entry("include expansion", boost::bind(
+      expandIncludes, boost::cref(s))));
+  benchmarks.push_back(Entry("load", boost::bind(
+      load, boost::cref(s), parse::ParseOptions(parse::DescentParser),
+      "load")));
+  benchmarks.push_back(Entry("load lazy", boost::bind(
+      load, boost::cref(s), lazy, "load lazy")));
+  benchmarks.push_back(Entry("lookup double", boost::bind(
+      lookups<double>, boost::cref(s), boost::cref(a.numbers), n,
+      "lookup double")));
+  benchmarks.push_back(Entry("lookup bool", boost::bind(
+      lookups<bool>, boost::cref(s), boost::cref(a.bools), n,
+      "lookup bool")));
+  benchmarks.push_back(Entry("lookup string", boost::bind(
+      lookups<std::string>, boost::cref(s), boost::cref(a.strings), n,
+      "lookup string")));
+  benchmarks.push_back(Entry("lookup reference", boost::bind(
+      lookups<std::string>, boost::cref(s), boost::cref(a.references), n,
+      "lookup reference")));
+  benchmarks.push_back(Entry("lookup string list", boost::bind(
+      lookups<std::vector<std::string> >, boost::cref(s),
+      boost::cref(a.stringLists), n, "lookup string list")));
+  benchmarks.push_back(Entry("lookup double list", boost::bind(
+      lookups<std::vector<double> >, boost::cref(s),
+      boost::cref(a.numberLists), n, "lookup double list")));
+  benchmarks.push_back(Entry("lookup string view", boost::bind(
+      lookups<boost::string_ref>, boost::cref(s), boost::cref(a.strings), n,
+      "lookup string view")));
+  benchmarks.push_back(Entry("lookup string list view", boost::bind(
+      lookups<ListView<std::string> >, boost::cref(s),
+      boost::cref(a.stringLists), n, "lookup string list view")));
+  benchmarks.push_back(Entry("lookup double list view", boost::bind(
+      lookups<ListView<double> >, boost::cref(s),
+      boost::cref(a.numberLists), n, "lookup double list view")));
+  // Sections are copied, so fewer are looked up.
+  benchmarks.push_back(Entry("lookup section", boost::bind(
+      lookups<ConfigType>, boost::cref(s), boost::cref(a.sections),
+      std::max(n / 100, 1L), "lookup section")));
+  benchmarks.push_back(Entry("lookup alias", boost::bind(
+      lookups<double>, boost::cref(s), boost::cref(a.aliased), n,
+      "lookup alias")));
+  benchmarks.push_back(Entry("lookup missing", boost::bind(
+      lookups<double>, boost::cref(s), boost::cref(a.missing), n,
+      "lookup missing")));
+  benchmarks.push_back(Entry("mismatch throw", boost::bind(
+      failedLookups<bool>, boost::cref(s), boost::cref(a.numbers), n, false,
+      "mismatch throw")));
+  benchmarks.push_back(Entry("mismatch status", boost::bind(
+      failedLookups<bool>, boost::cref(s), boost::cref(a.numbers), n, true,
+      "mismatch status")));
+  benchmarks.push_back(Entry("not section throw", boost::bind(
+      failedLookups<double>, boost::cref(s), boost::cref(belowValues), n,
+      false, "not section throw")));
+  benchmarks.push_back(Entry("not section status", boost::bind(
+      failedLookups<double>, boost::cref(s), boost::cref(belowValues), n,
+      true, "not section status")));
+  benchmarks.push_back(Entry("startup", boost::bind(
+      batchLookups, boost::cref(s))));
+  benchmarks.push_back(Entry("query", boost::bind(
+      queries, boost::cref(s))));
+  benchmarks.push_back(Entry("resolve references", boost::bind(
+      resolveReferences, boost::cref(s))));
+  benchmarks.push_back(Entry("print", boost::bind(
+      printConfig, boost::cref(s))));
+
+  BOOST_FOREACH(Entry const& entry, benchmarks)
+    if(selected(names, entry.first))
+      isolated(entry.second);
+
+  boost::filesystem::remove_all(directory);
+  return 0;
+}